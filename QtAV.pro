@@ -59,6 +59,7 @@ qtCompileTest(avutil)|error("FFmpeg avutil is required, but not available")
 qtCompileTest(avcodec)|error("FFmpeg avcodec is required, but not available")
 qtCompileTest(avformat)|error("FFmpeg avformat is required, but not available")
 qtCompileTest(swscale)|error("FFmpeg swscale is required, but not available")
+qtCompileTest(swresample)|error("FFmpeg swresample is required, but not available")
 qtCompileTest(portaudio)|warning("PortAudio is not available. No audio output in QtAV")
 qtCompileTest(direct2d)
 qtCompileTest(gdiplus)
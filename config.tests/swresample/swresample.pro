@@ -0,0 +1,7 @@
+CONFIG -= qt
+CONFIG += console
+DEFINES += __STDC_CONSTANT_MACROS
+
+SOURCES += main.cpp
+
+LIBS += -lswresample
@@ -22,11 +22,20 @@
 
 #include <QtAV/AOPortAudio.h>
 #include <private/AudioOutput_p.h>
+#include <private/AudioRing_p.h>
 #include <portaudio.h>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
 #include <QtCore/QString>
+#include <QtCore/QWaitCondition>
+#include <string.h>
 
 namespace QtAV {
 
+//seconds of samples buffered in the ring besides the device's latency
+static const qreal kRingDuration = 0.2;
+static const qreal kRingDurationLow = 0.06;
+
 class AOPortAudioPrivate : public AudioOutputPrivate
 {
 public:
@@ -34,6 +43,11 @@ public:
         initialized(false)
       ,outputParameters(new PaStreamParameters)
       ,stream(0)
+      ,pull(true)
+      ,low_latency(false)
+      ,closing(false)
+      ,starved(false)
+      ,underruns(0)
     {
         PaError err = paNoError;
         if ((err = Pa_Initialize()) != paNoError) {
@@ -72,6 +86,39 @@ public:
         outputParameters->hostApiSpecificStreamInfo = NULL;
         outputParameters->suggestedLatency = Pa_GetDeviceInfo(outputParameters->device)->defaultHighOutputLatency;
     }
+    //called by PortAudio in its realtime thread. no lock, no allocation
+    static int callback(const void *input, void *output, unsigned long frameCount
+                        , const PaStreamCallbackTimeInfo *timeInfo, PaStreamCallbackFlags statusFlags, void *userData) {
+        Q_UNUSED(input);
+        Q_UNUSED(timeInfo);
+        Q_UNUSED(statusFlags);
+        AOPortAudioPrivate *d = static_cast<AOPortAudioPrivate*>(userData);
+        const int wanted = frameCount*d->channels;
+        float *out = static_cast<float*>(output);
+        const int got = d->ring.read(out, wanted);
+        if (got < wanted) {
+            memset(out + got, 0, (wanted - got)*sizeof(float));
+            //count once when the ring runs dry, not every callback while nothing is written
+            if (!d->starved)
+                d->underruns.fetchAndAddOrdered(1);
+            d->starved = true;
+        } else {
+            d->starved = false;
+        }
+        return paContinue;
+    }
+    //block the audio thread until the ring has space for floats. not in the driver
+    bool waitForSpace(int floats) {
+        QMutexLocker lock(&wait_mutex);
+        Q_UNUSED(lock);
+        while (!closing && ring.capacity() - ring.available() < floats) {
+            const int missing = floats - (ring.capacity() - ring.available());
+            //the callback drains sample_rate*channels floats per second
+            const unsigned long ms = qMax<qint64>(1, qint64(missing)*1000/qMax(1, sample_rate*channels));
+            wait_cond.wait(&wait_mutex, ms);
+        }
+        return !closing;
+    }
     ~AOPortAudioPrivate() {
         if (initialized)
             Pa_Terminate(); //Do NOT call this if init failed. See document
@@ -84,6 +131,14 @@ public:
     bool initialized;
     PaStreamParameters *outputParameters;
     PaStream *stream;
+    bool pull; //the callback reads from ring
+    bool low_latency;
+    volatile bool closing; //wake up the audio thread waiting for space
+    bool starved; //used by the callback only
+    QAtomicInt underruns;
+    AudioRing ring;
+    QMutex wait_mutex;
+    QWaitCondition wait_cond;
 #ifdef Q_OS_LINUX
     bool autoFindMultichannelDevice;
 #endif
@@ -100,9 +155,80 @@ AOPortAudio::~AOPortAudio()
     close();
 }
 
+void AOPortAudio::setPullMode(bool pull)
+{
+    d_func().pull = pull;
+}
+
+bool AOPortAudio::isPullMode() const
+{
+    return d_func().pull;
+}
+
+void AOPortAudio::setLowLatency(bool low)
+{
+    d_func().low_latency = low;
+}
+
+bool AOPortAudio::isLowLatency() const
+{
+    return d_func().low_latency;
+}
+
+int AOPortAudio::underruns() const
+{
+    return const_cast<QAtomicInt&>(d_func().underruns).fetchAndAddOrdered(0);
+}
+
+qreal AOPortAudio::bufferLevel() const
+{
+    DPTR_D(const AOPortAudio);
+    if (!d.pull || d.ring.capacity() == 0)
+        return 0;
+    return qreal(d.ring.available())/qreal(d.ring.capacity());
+}
+
+qreal AOPortAudio::latency() const
+{
+    DPTR_D(const AOPortAudio);
+    if (!d.stream)
+        return 0;
+    qreal t = d.outputLatency;
+    //pull mode: the samples in the ring are not in the device yet
+    if (d.pull && d.sample_rate > 0 && d.channels > 0)
+        t += qreal(d.ring.available())/qreal(d.sample_rate*d.channels);
+    return t;
+}
+
+void AOPortAudio::clear()
+{
+    DPTR_D(AOPortAudio);
+    if (!d.pull)
+        return;
+    d.ring.discard();
+}
+
 bool AOPortAudio::write()
 {
     DPTR_D(AOPortAudio);
+    if (d.pull) {
+        const float *samples = (const float*)d.data.constData();
+        //whole frames. the ring never writes a partial one
+        const int channels = qMax(d.channels, 1);
+        int left = d.data.size()/sizeof(float)/channels*channels;
+        while (left > 0) {
+            //the data may be larger than the ring
+            if (!d.waitForSpace(qMin(left, d.ring.capacity()/2)))
+                return false;
+            const int n = d.ring.write(samples, left);
+            samples += n;
+            left -= n;
+            //start when some samples are buffered, otherwise the first callbacks underrun
+            if (Pa_IsStreamStopped(d.stream))
+                Pa_StartStream(d.stream);
+        }
+        return true;
+    }
     if (Pa_IsStreamStopped(d.stream))
         Pa_StartStream(d.stream);
 #if KNOW_WHY
@@ -142,11 +268,29 @@ bool AOPortAudio::write()
 bool AOPortAudio::open()
 {
     DPTR_D(AOPortAudio);
+    //reopen with the new format
+    if (d.stream)
+        close();
+    const PaDeviceInfo *info = Pa_GetDeviceInfo(d.outputParameters->device);
+    if (info && info->maxOutputChannels > 0 && d.channels > info->maxOutputChannels) {
+        //e.g. 5.1 on a stereo device. the audio is remixed to the device's channels
+        qDebug("audio device supports %d channels. requested %d", info->maxOutputChannels, d.channels);
+        d.channels = info->maxOutputChannels;
+    }
     d.outputParameters->channelCount = d.channels;
-    PaError err = Pa_OpenStream(&d.stream, NULL, d.outputParameters, d.sample_rate, 0, paNoFlag, NULL, NULL);
+    if (info)
+        d.outputParameters->suggestedLatency = d.low_latency ? info->defaultLowOutputLatency : info->defaultHighOutputLatency;
+    if (d.pull) {
+        d.ring.resize(d.sample_rate*d.channels*(d.low_latency ? kRingDurationLow : kRingDuration), d.channels);
+        d.starved = false;
+    }
+    d.closing = false;
+    PaError err = Pa_OpenStream(&d.stream, NULL, d.outputParameters, d.sample_rate, paFramesPerBufferUnspecified, paNoFlag
+                                , d.pull ? AOPortAudioPrivate::callback : NULL, d.pull ? &d : NULL);
     if (err == paNoError) {
         d.outputLatency = Pa_GetStreamInfo(d.stream)->outputLatency;
         d.available = true;
+        d.opened = true;
     } else {
         qWarning("Open portaudio stream error: %s", Pa_GetErrorText(err));
         d.available = false;
@@ -158,6 +302,9 @@ bool AOPortAudio::close()
 {
     DPTR_D(AOPortAudio);
     PaError err = paNoError;
+    //the audio thread may wait for the space in the ring
+    d.closing = true;
+    d.wait_cond.wakeAll();
     if (!d.stream) {
         return true;
     }
@@ -166,6 +313,8 @@ bool AOPortAudio::close()
         qWarning("Stop portaudio stream error: %s", Pa_GetErrorText(err));
     err = Pa_CloseStream(d.stream);
     d.stream = NULL;
+    d.opened = false;
+    d.ring.clear();
     if (err != paNoError)
         qWarning("Close portaudio stream error: %s", Pa_GetErrorText(err));
     return err == paNoError;
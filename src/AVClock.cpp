@@ -25,30 +25,36 @@
 namespace QtAV {
 
 AVClock::AVClock(AVClock::ClockType c, QObject *parent)
-    :QObject(parent),auto_clock(true),clock_type(c)
+    :QObject(parent),auto_clock(true),clock_type(c),running(false),speed_(1.0)
+    ,pts_v(0),delay_(0),snap_pts(0),snap_rate(0),snap_limit(-1),snap_ns(0)
 {
-    pts_ = pts_v = delay_ = 0;
+    epoch.start();
 }
 
 AVClock::AVClock(QObject *parent)
-    :QObject(parent),auto_clock(true),clock_type(AudioClock)
+    :QObject(parent),auto_clock(true),clock_type(AudioClock),running(false),speed_(1.0)
+    ,pts_v(0),delay_(0),snap_pts(0),snap_rate(0),snap_limit(-1),snap_ns(0)
 {
-    pts_ = pts_v = delay_ = 0;
+    epoch.start();
 }
 
 void AVClock::setClockType(ClockType ct)
 {
+    if (clock_type == ct)
+        return;
     clock_type = ct;
+    //keep the current value, the new type decides how it advances
+    setBase(value(), ct == AudioClock || running, ct == AudioClock ? delay_ : -1);
 }
 
 AVClock::ClockType AVClock::clockType() const
 {
-    return clock_type;
+    return (ClockType)clock_type;
 }
 
 bool AVClock::isActive() const
 {
-    return clock_type == AudioClock || timer.isValid();
+    return clock_type == AudioClock || running;
 }
 
 void AVClock::setClockAuto(bool a)
@@ -61,28 +67,55 @@ bool AVClock::isClockAuto() const
     return auto_clock;
 }
 
+void AVClock::setSpeed(double speed)
+{
+    if (speed <= 0) {
+        qWarning("AVClock: invalid speed %f", speed);
+        return;
+    }
+    QMutexLocker lock(&write_mutex);
+    Q_UNUSED(lock);
+    //rebase at the current value so that the speed change does not make a jump
+    Snapshot s = snapshot();
+    const qint64 t = now();
+    if (s.rate != 0) {
+        double dt = double(t - s.base_ns) * 1e-9 * s.rate;
+        if (s.limit >= 0 && dt > s.limit) {
+            dt = s.limit;
+        }
+        s.pts += dt;
+        if (s.limit >= 0)
+            s.limit -= dt;
+        s.rate = speed;
+    }
+    s.base_ns = t;
+    speed_ = speed;
+    publish(s);
+}
+
 void AVClock::updateExternalClock(qint64 msecs)
 {
     if (clock_type != ExternalClock)
         return;
     qDebug("External clock change: %f ==> %f", value(), double(msecs) * kThousandth);
-    pts_ = double(msecs) * kThousandth; //can not use msec/1000.
-    timer.restart();
+    setBase(double(msecs) * kThousandth, running, -1); //can not use msec/1000.
 }
 
 void AVClock::updateExternalClock(const AVClock &clock)
 {
     if (clock_type != ExternalClock)
         return;
-    qDebug("External clock change: %f ==> %f", value(), clock.value());
-    pts_ = clock.value();
-    timer.restart();
+    const double v = clock.value();
+    qDebug("External clock change: %f ==> %f", value(), v);
+    setBase(v, running, -1);
 }
 
 void AVClock::start()
 {
     qDebug("AVClock started!!!!!!!!");
-    timer.start();
+    running = true;
+    if (clock_type == ExternalClock)
+        setBase(pts(), true, -1);
     emit started();
 }
 //remember last value because we don't reset  pts_, pts_v, delay_
@@ -91,14 +124,12 @@ void AVClock::pause(bool p)
     if (clock_type != ExternalClock)
         return;
     if (p) {
-#if QT_VERSION >= QT_VERSION_CHECK(4, 7, 0)
-        timer.invalidate();
-#else
-        timer.stop();
-#endif //QT_VERSION >= QT_VERSION_CHECK(4, 7, 0)
+        setBase(value(), false, -1);
+        running = false;
         emit paused();
     } else {
-        timer.start();
+        running = true;
+        setBase(value(), true, -1);
         emit resumed();
     }
     emit paused(p);
@@ -106,14 +137,33 @@ void AVClock::pause(bool p)
 
 void AVClock::reset()
 {
-    pts_ = pts_v = delay_ = 0;
-#if QT_VERSION >= QT_VERSION_CHECK(4, 7, 0)
-    timer.invalidate();
-#else
-    timer.stop();
-#endif //QT_VERSION >= QT_VERSION_CHECK(4, 7, 0)
+    pts_v = delay_ = 0;
+    running = false;
+    setBase(0, false, -1);
     emit resetted();
 }
 
+void AVClock::publish(const Snapshot &s)
+{
+    seq.fetchAndAddOrdered(1); //odd: readers wait
+    snap_pts = s.pts;
+    snap_ns = s.base_ns;
+    snap_rate = s.rate;
+    snap_limit = s.limit;
+    seq.fetchAndAddOrdered(1);
+}
+
+void AVClock::setBase(double pts, bool run, double limit)
+{
+    QMutexLocker lock(&write_mutex);
+    Q_UNUSED(lock);
+    //in the lock, so the base time and the speed are not older than the ones published by another writer
+    Snapshot s;
+    s.pts = pts;
+    s.base_ns = now();
+    s.rate = run ? speed_ : 0;
+    s.limit = limit;
+    publish(s);
+}
 
 } //namespace QtAV
@@ -21,6 +21,7 @@
 
 #include <QtAV/AVDecoder.h>
 #include <private/AVDecoder_p.h>
+#include <QtAV/Packet.h>
 
 namespace QtAV {
 AVDecoder::AVDecoder()
@@ -65,6 +66,11 @@ bool AVDecoder::decode(const QByteArray &encoded)
     return true;
 }
 
+bool AVDecoder::decode(const Packet &packet)
+{
+    return decode(packet.data);
+}
+
 QByteArray AVDecoder::data() const
 {
     return d_func().decoded;
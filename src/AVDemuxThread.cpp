@@ -22,22 +22,26 @@
 #include <QtAV/AVDemuxThread.h>
 #include <QtAV/AVDemuxer.h>
 #include <QtAV/AVDecoder.h>
+#include <QtAV/AVClock.h>
 #include <QtAV/Packet.h>
 #include <QtAV/AVThread.h>
-#include <QtCore/QTimer>
-#include <QtCore/QEventLoop>
+#include <QtAV/QtAV_Compat.h>
 
 namespace QtAV {
 
+static const qreal kSeekStep = 16.0; //seconds. seekForward() and seekBackward()
+
 AVDemuxThread::AVDemuxThread(QObject *parent) :
-    QThread(parent),paused(false),seeking(false),end(false)
+    QThread(parent),paused(false),end(false)
     ,demuxer(0),audio_thread(0),video_thread(0)
+    ,seek_request(-1),audio_stream_request(-2),seek_landing(false),seek_step(false),serial(0)
 {
 }
 
 AVDemuxThread::AVDemuxThread(AVDemuxer *dmx, QObject *parent) :
-    QThread(parent),paused(false),seeking(false),end(false)
+    QThread(parent),paused(false),end(false)
     ,audio_thread(0),video_thread(0)
+    ,seek_request(-1),audio_stream_request(-2),seek_landing(false),seek_step(false),serial(0)
 {
     setDemuxer(dmx);
 }
@@ -70,59 +74,95 @@ void AVDemuxThread::setVideoThread(AVThread *thread)
 
 void AVDemuxThread::seek(qreal pos)
 {
-    seeking = true;
-    audio_thread->packetQueue()->clear();
-    video_thread->packetQueue()->clear();
-    demuxer->seek(pos);
-    seeking = false;
-    seek_cond.wakeAll();
-    if (isPaused()) {
-        pause(false);
-        video_thread->pause(false);
-        QEventLoop loop;
-        QTimer::singleShot(40, &loop, SLOT(quit()));
-        loop.exec();
-        pause(true);
-        video_thread->pause(true);
+    if (demuxer->isLoading()) {
+        qDebug("can not seek. loading");
+        return;
     }
+    if (!isRunning()) {
+        //nothing is demuxing or decoding
+        demuxer->seek(pos);
+        if (demuxer->seekTarget() >= 0)
+            emit seekFinished(demuxer->seekTarget());
+        return;
+    }
+    {
+        QMutexLocker lock(&seek_mutex);
+        Q_UNUSED(lock);
+        if (seek_request >= 0)
+            qDebug("seek request %f is replaced by %f", seek_request, pos);
+        seek_request = qMax<qreal>(pos, 0);
+    }
+    //the demuxing thread may wait for pause or for a full queue
+    audio_thread->packetQueue()->blockFull(false);
+    video_thread->packetQueue()->blockFull(false);
+    QMutexLocker lock(&buffer_mutex);
+    Q_UNUSED(lock);
+    cond.wakeAll();
 }
 
 void AVDemuxThread::seekForward()
 {
-    seeking = true;
-    audio_thread->packetQueue()->clear();
-    video_thread->packetQueue()->clear();
-    demuxer->seekForward();
-    seeking = false;
-    seek_cond.wakeAll();
-    if (isPaused()) {
-        pause(false);
-        video_thread->pause(false);
-        QEventLoop loop;
-        QTimer::singleShot(40, &loop, SLOT(quit()));
-        loop.exec();
-        pause(true);
-        video_thread->pause(true);
-    }
+    seekBy(kSeekStep);
 }
 
 void AVDemuxThread::seekBackward()
 {
-    seeking = true;
-    audio_thread->packetQueue()->clear();
-    video_thread->packetQueue()->clear();
-    demuxer->seekBackward();
-    seeking = false;
-    seek_cond.wakeAll();
-    if (isPaused()) {
-        pause(false);
-        video_thread->pause(false);
-        QEventLoop loop;
-        QTimer::singleShot(40, &loop, SLOT(quit()));
-        loop.exec();
-        pause(true);
-        video_thread->pause(true);
+    seekBy(-kSeekStep);
+}
+
+void AVDemuxThread::seekBy(qreal secs)
+{
+    if (demuxer->isLoading()) {
+        qDebug("can not seek. loading");
+        return;
+    }
+    const qreal duration = qreal(demuxer->duration())/qreal(AV_TIME_BASE);
+    if (duration <= 0) {
+        qWarning("can not seek. unknown duration");
+        return;
+    }
+    qreal pos = -1;
+    {
+        QMutexLocker lock(&seek_mutex);
+        Q_UNUSED(lock);
+        pos = seek_request; //steps accumulate if not performed yet
+    }
+    if (pos < 0) {
+        if (!demuxer->clock()) {
+            qWarning("[AVDemuxThread] No master clock!");
+            return;
+        }
+        pos = demuxer->clock()->value()/duration;
+    }
+    seek(pos + secs/duration);
+}
+
+bool AVDemuxThread::setAudioStream(int index)
+{
+    if (demuxer->isLoading()) {
+        qDebug("can not switch the audio stream. loading");
+        return false;
+    }
+    if (index >= 0 && !demuxer->audioStreams().contains(index)) {
+        qWarning("[AVDemuxThread] %d is not an audio stream", index);
+        return false;
+    }
+    if (!isRunning()) {
+        //nothing is decoding
+        if (!demuxer->setAudioStream(index))
+            return false;
+        audio_thread->decoder()->setCodecContext(demuxer->audioCodecContext());
+        return true;
     }
+    {
+        QMutexLocker lock(&seek_mutex);
+        Q_UNUSED(lock);
+        audio_stream_request = index;
+    }
+    //the demuxing thread may wait for a full queue
+    audio_thread->packetQueue()->blockFull(false);
+    video_thread->packetQueue()->blockFull(false);
+    return true;
 }
 
 bool AVDemuxThread::isPaused() const
@@ -147,8 +187,87 @@ void AVDemuxThread::pause(bool p)
     if (paused == p)
         return;
     paused = p;
-    if (!paused)
+    if (!paused) {
+        QMutexLocker lock(&buffer_mutex);
+        Q_UNUSED(lock);
         cond.wakeAll();
+    }
+}
+
+bool AVDemuxThread::processAudioStreamRequest()
+{
+    if (paused) //the audio thread is paused too
+        return false;
+    int index = -2;
+    {
+        QMutexLocker lock(&seek_mutex);
+        Q_UNUSED(lock);
+        index = audio_stream_request;
+        audio_stream_request = -2;
+    }
+    if (index == -2)
+        return false;
+    //setAudioStream() stopped blocking to wake up this thread
+    audio_thread->packetQueue()->blockFull(true);
+    video_thread->packetQueue()->blockFull(true);
+    if (index >= 0 && index == audio_stream)
+        return false;
+    //the old codec context is closed by the demuxer
+    audio_thread->stop();
+    audio_thread->wait();
+    const bool ok = demuxer->setAudioStream(index);
+    if (ok) {
+        audio_stream = demuxer->audioStream();
+        audio_thread->decoder()->setCodecContext(demuxer->audioCodecContext());
+    }
+    //the packets put later carry the current serial. stop() cleared the old stream's packets
+    audio_thread->setSerial(serial);
+    audio_thread->start(QThread::HighestPriority);
+    if (!ok)
+        return false;
+    //the new stream is demuxed after the buffered packets. play it from the current position
+    const qreal duration = qreal(demuxer->duration())/qreal(AV_TIME_BASE);
+    if (duration > 0 && demuxer->clock()) {
+        QMutexLocker lock(&seek_mutex);
+        Q_UNUSED(lock);
+        if (seek_request < 0)
+            seek_request = demuxer->clock()->value()/duration;
+    }
+    return true;
+}
+
+void AVDemuxThread::processSeekRequest()
+{
+    qreal pos = -1;
+    {
+        QMutexLocker lock(&seek_mutex);
+        Q_UNUSED(lock);
+        pos = seek_request;
+        seek_request = -1;
+    }
+    if (pos < 0)
+        return;
+    //seek() stopped blocking to wake up this thread
+    audio_thread->packetQueue()->blockFull(true);
+    video_thread->packetQueue()->blockFull(true);
+    demuxer->seek(pos);
+    const qreal target = demuxer->seekTarget();
+    if (target < 0) {
+        qWarning("seek to %f failed", pos);
+        return;
+    }
+    //accurate seek: the threads decode to the target and discard the data before it
+    const qreal accurate = demuxer->seekType() == AVDemuxer::AccurateSeek ? target : -1;
+    ++serial;
+    audio_thread->flush(serial, accurate);
+    video_thread->flush(serial, accurate);
+    landing = accurate;
+    seek_landing = true;
+    //show the frame at the new position. the video thread is paused again when it's displayed
+    if (paused && video_thread->decoder()->isAvailable()) {
+        seek_step = true;
+        video_thread->pause(false);
+    }
 }
 
 void AVDemuxThread::run()
@@ -156,6 +275,8 @@ void AVDemuxThread::run()
     end = false;
     Q_ASSERT(audio_thread != 0);
     Q_ASSERT(video_thread != 0);
+    //before the threads start. they start from serial 0 too, see AVThread::resetState()
+    serial = 0;
     if (!audio_thread->isRunning())
         audio_thread->start(QThread::HighPriority);
     if (!video_thread->isRunning())
@@ -166,6 +287,13 @@ void AVDemuxThread::run()
     int index = 0;
     Packet pkt;
     end = false;
+    {
+        QMutexLocker lock(&seek_mutex);
+        Q_UNUSED(lock);
+        seek_request = -1;
+        audio_stream_request = -2;
+    }
+    seek_landing = seek_step = false;
     pause(false);
     PacketQueue *aqueue = audio_thread->packetQueue();
     PacketQueue *vqueue = video_thread->packetQueue();
@@ -174,49 +302,63 @@ void AVDemuxThread::run()
     bool _has_audio = audio_thread->decoder()->isAvailable();
     bool _has_video = video_thread->decoder()->isAvailable();
     while (!end) {
+        if (processAudioStreamRequest())
+            _has_audio = audio_thread->decoder()->isAvailable();
+        processSeekRequest();
+        if (seek_step && video_thread->seekLatency() >= 0) {
+            seek_step = false;
+            if (paused)
+                video_thread->pause(true);
+        }
         if (tryPause())
             continue; //the queue is empty and will block
-        QMutexLocker locker(&buffer_mutex);
-        Q_UNUSED(locker);
-        if (seeking) {
-            qDebug("Demuxer is seeking... wait for seek end");
-            if (!seek_cond.wait(&buffer_mutex, 1000)) { //will return the same state(i.e. lock)
-                qWarning("seek timed out");
-            }
-        }
         if (!demuxer->readFrame()) {
             continue;
         }
         index = demuxer->stream();
-        pkt = *demuxer->packet(); //TODO: how to avoid additional copy?
+        pkt = *demuxer->packet(); //payload is shared, not copied
+        pkt.serial = serial;
+        if (seek_landing && (index == (_has_video ? video_stream : audio_stream))) {
+            seek_landing = false;
+            emit seekFinished(landing >= 0 ? landing : pkt.pts);
+        }
         /*1 is empty but another is enough, then do not block to
           ensure the empty one can put packets immediatly.
           But usually it will not happen, why?
         */
         if (index == audio_stream) {
             if (_has_video)
-                aqueue->blockFull(vqueue->size() >= vqueue->threshold());
+                aqueue->blockFull(vqueue->isEnough());
             aqueue->put(pkt); //affect video_thread
         } else if (index == video_stream) {
             if (_has_audio)
-                vqueue->blockFull(aqueue->size() >= aqueue->threshold());
+                vqueue->blockFull(aqueue->isEnough());
             vqueue->put(pkt); //affect audio_thread
         } else { //subtitle
             continue;
         }
     }
-    //flush. seeking will be omitted when stopped
-    aqueue->put(Packet());
-    vqueue->put(Packet());
+    //end marker. the decoders are not flushed again for the same serial
+    Packet eos;
+    eos.serial = serial;
+    aqueue->put(eos);
+    vqueue->put(eos);
     qDebug("Demux thread stops running....");
 }
 
 bool AVDemuxThread::tryPause()
 {
-    if (!paused)
+    //keep demuxing until the frame at the new position is displayed
+    if (!paused || seek_step)
         return false;
     QMutexLocker lock(&buffer_mutex);
     Q_UNUSED(lock);
+    {
+        QMutexLocker seek_lock(&seek_mutex);
+        Q_UNUSED(seek_lock);
+        if (seek_request >= 0) //requested before waiting
+            return true;
+    }
     cond.wait(&buffer_mutex); //TODO: qApp->processEvents?
     return true;
 }
@@ -23,17 +23,48 @@
 #include <QtAV/AVDemuxer.h>
 #include <QtAV/Packet.h>
 #include <QtAV/QtAV_Compat.h>
+#include <private/KeyFrameIndex_p.h>
+#include <private/MappedIO_p.h>
+#include <private/ReadAheadIO_p.h>
+#include <private/StreamInfoCache_p.h>
 #include <QtCore/QThread>
 #include <QtCore/QCoreApplication>
+#include <QtCore/QFileInfo>
 
 namespace QtAV {
 
-const qint64 kSeekInterval = 168; //ms
+//the fast open profile. see setFastOpen()
+static const int kFastProbeSize = 64*1024; //bytes
+static const qint64 kFastAnalyzeDuration = 500000LL; //us
+static const int kFastFpsProbeSize = 3; //frames
+
+class AVDemuxer::LoadThread : public QThread
+{
+public:
+    LoadThread(AVDemuxer *dmx):QThread(dmx),demuxer(dmx) {}
+    QString file_name;
+protected:
+    virtual void run() {
+        demuxer->load_ok = demuxer->load(file_name);
+    }
+private:
+    AVDemuxer *demuxer;
+};
+
 AVDemuxer::AVDemuxer(const QString& fileName, QObject *parent)
     :QObject(parent),started_(false),eof(false),pkt(new Packet())
     ,ipts(0),stream_idx(-1),audio_stream(-2),video_stream(-2)
-    ,subtitle_stream(-2),_is_input(true),format_context(0)
+    ,subtitle_stream(-2),wanted_audio_stream(-1),wanted_video_stream(-1)
+    ,_is_input(true),format_context(0)
 	,a_codec_context(0),v_codec_context(0),_file_name(fileName),master_clock(0)
+    ,seek_type(KeyFrameSeek),seek_target(-1)
+    ,index_enabled(false),key_index(0)
+    ,fast_open(false),cache_info(false),info_cached(false)
+    ,probe_size(0),fps_probe_size(0),analyze_duration(0)
+    ,open_time(0),info_time(0),load_time(0)
+    ,load_thread(0),loading(false),load_ok(false)
+    ,mmap_enabled(true),mapped_io(0)
+    ,read_ahead_size(0),read_ahead_io(0)
     ,__interrupt_status(0)
 {
     av_register_all();
@@ -48,11 +79,27 @@ AVDemuxer::AVDemuxer(const QString& fileName, QObject *parent)
 
 AVDemuxer::~AVDemuxer()
 {
+    if (load_thread) {
+        __interrupt_status = 1;
+        load_thread->wait();
+    }
     close();
     if (pkt) {
         delete pkt;
         pkt = 0;
     }
+    if (key_index) {
+        delete key_index; //stops scanning
+        key_index = 0;
+    }
+    if (mapped_io) {
+        delete mapped_io;
+        mapped_io = 0;
+    }
+    if (read_ahead_io) {
+        delete read_ahead_io;
+        read_ahead_io = 0;
+    }
     avformat_network_deinit();
 }
 
@@ -130,32 +177,19 @@ bool AVDemuxer::readFrame()
     }
     if (stream_idx != videoStream() && stream_idx != audioStream()) {
         //qWarning("[AVDemuxer] unknown stream index: %d", stream_idx);
+        av_free_packet(&packet);
         return false;
     }
-    pkt->data = QByteArray((const char*)packet.data, packet.size);
-    pkt->duration = packet.duration;
-    //if (packet.dts == AV_NOPTS_VALUE && )
-    if (packet.dts != AV_NOPTS_VALUE) //has B-frames
-        pkt->pts = packet.dts;
-    else if (packet.pts != AV_NOPTS_VALUE)
-        pkt->pts = packet.pts;
-    else
-        pkt->pts = 0;
-
     AVStream *stream = format_context->streams[stream_idx];
-    pkt->pts *= av_q2d(stream->time_base);
-
+    //the payload is not copied. pkt holds the reference and av_free_packet() is called when it's released
+    *pkt = Packet::fromAVPacket(&packet, av_q2d(stream->time_base));
+    if (!pkt->asAVPacket()) //an invalid packet is a flush packet for AVThread
+        return false;
     if (stream->codec->codec_type == AVMEDIA_TYPE_SUBTITLE
-            && (packet.flags & AV_PKT_FLAG_KEY)
-            &&  packet.convergence_duration != AV_NOPTS_VALUE)
-        pkt->duration = packet.convergence_duration * av_q2d(stream->time_base);
-    else if (packet.duration > 0)
-        pkt->duration = packet.duration * av_q2d(stream->time_base);
-    else
-        pkt->duration = 0;
-    //qDebug("AVPacket.pts=%f, duration=%f, dts=%lld", pkt->pts, pkt->duration, packet.dts);
-
-    av_free_packet(&packet); //important!
+            && pkt->hasKeyFrame
+            && pkt->asAVPacket()->convergence_duration != AV_NOPTS_VALUE)
+        pkt->duration = pkt->asAVPacket()->convergence_duration * av_q2d(stream->time_base);
+    //qDebug("AVPacket.pts=%f, duration=%f", pkt->pts, pkt->duration);
     return true;
 }
 
@@ -179,7 +213,8 @@ bool AVDemuxer::close()
     eof = false;
     stream_idx = -1;
     audio_stream = video_stream = subtitle_stream = -2;
-    __interrupt_status = 0;
+    if (key_index)
+        key_index->stop();
     if (a_codec_context) {
         qDebug("closing a_codec_context");
         avcodec_close(a_codec_context);
@@ -192,10 +227,18 @@ bool AVDemuxer::close()
     }
     //av_close_input_file(format_context); //deprecated
     if (format_context) {
+        //the track selected for this file is not a track of the next one. a selection before loading is kept
+        wanted_audio_stream = -1;
         qDebug("closing format_context");
         avformat_close_input(&format_context); //libavf > 53.10.0
         format_context = 0;
     }
+    //not closed by avformat_close_input() because of AVFMT_FLAG_CUSTOM_IO
+    if (mapped_io)
+        mapped_io->close();
+    //the statistics are kept until the next load
+    if (read_ahead_io && read_ahead_io->isOpen())
+        read_ahead_io->close();
     return true;
 }
 
@@ -209,23 +252,144 @@ AVClock* AVDemuxer::clock() const
 	return master_clock;
 }
 
+void AVDemuxer::setSeekType(SeekType type)
+{
+    seek_type = type;
+}
+
+AVDemuxer::SeekType AVDemuxer::seekType() const
+{
+    return seek_type;
+}
+
+qreal AVDemuxer::seekTarget() const
+{
+    return seek_target;
+}
+
+void AVDemuxer::setKeyFrameIndexEnabled(bool enabled)
+{
+    index_enabled = enabled;
+}
+
+bool AVDemuxer::isKeyFrameIndexEnabled() const
+{
+    return index_enabled;
+}
+
+void AVDemuxer::setFastOpen(bool fast)
+{
+    fast_open = fast;
+}
+
+bool AVDemuxer::isFastOpen() const
+{
+    return fast_open;
+}
+
+void AVDemuxer::setProbeSize(int bytes)
+{
+    probe_size = bytes;
+}
+
+int AVDemuxer::probeSize() const
+{
+    return probe_size;
+}
+
+void AVDemuxer::setAnalyzeDuration(qint64 us)
+{
+    analyze_duration = us;
+}
+
+qint64 AVDemuxer::analyzeDuration() const
+{
+    return analyze_duration;
+}
+
+void AVDemuxer::setFpsProbeSize(int frames)
+{
+    fps_probe_size = frames;
+}
+
+int AVDemuxer::fpsProbeSize() const
+{
+    return fps_probe_size;
+}
+
+void AVDemuxer::setStreamInfoCacheEnabled(bool enabled)
+{
+    cache_info = enabled;
+}
+
+bool AVDemuxer::isStreamInfoCacheEnabled() const
+{
+    return cache_info;
+}
+
+void AVDemuxer::setMemoryMapEnabled(bool enabled)
+{
+    mmap_enabled = enabled;
+}
+
+bool AVDemuxer::isMemoryMapEnabled() const
+{
+    return mmap_enabled;
+}
+
+void AVDemuxer::setReadAheadSize(int bytes)
+{
+    read_ahead_size = qMax(0, bytes);
+}
+
+int AVDemuxer::readAheadSize() const
+{
+    return read_ahead_size;
+}
+
+int AVDemuxer::readAheadSeekHits() const
+{
+    return read_ahead_io ? read_ahead_io->seekHits() : 0;
+}
+
+int AVDemuxer::readAheadSeekMisses() const
+{
+    return read_ahead_io ? read_ahead_io->seekMisses() : 0;
+}
+
+int AVDemuxer::readAheadStalls() const
+{
+    return read_ahead_io ? read_ahead_io->readStalls() : 0;
+}
+
+bool AVDemuxer::isStreamInfoCached() const
+{
+    return info_cached;
+}
+
+qint64 AVDemuxer::openInputTime() const
+{
+    return open_time;
+}
+
+qint64 AVDemuxer::streamInfoTime() const
+{
+    return info_time;
+}
+
+qint64 AVDemuxer::loadTime() const
+{
+    return load_time;
+}
+
 //TODO: seek by byte
 void AVDemuxer::seek(qreal q)
 {
+    seek_target = -1;
     if ((!a_codec_context && !v_codec_context) || !format_context) {
         qWarning("can not seek. context not ready: %p %p %p", a_codec_context, v_codec_context, format_context);
         return;
     }
-    if (seek_timer.isValid()) {
-        //why sometimes seek_timer.elapsed() < 0
-        if (!seek_timer.hasExpired(kSeekInterval)) {
-            qDebug("seek too frequent. ignore");
-            return;
-        }
-        seek_timer.restart();
-    } else {
-        seek_timer.start();
-    }
     QMutexLocker lock(&mutex);
     Q_UNUSED(lock);
     q = qMax<qreal>(0.0, q);
@@ -250,17 +414,41 @@ void AVDemuxer::seek(qreal q)
     qDebug("[AVDemuxer] seek to %f %f %lld / %lld backward=%d", q, pkt->pts, t, duration(), backward);
 	//AVSEEK_FLAG_BACKWARD has no effect? because we know the timestamp
 	int seek_flag =  (backward ? 0 : AVSEEK_FLAG_BACKWARD); //AVSEEK_FLAG_ANY
-	int ret = av_seek_frame(format_context, -1, t, seek_flag);
+    //accurate: the key frame at or before t, then decode to t
+    if (seek_type == AccurateSeek)
+        seek_flag = AVSEEK_FLAG_BACKWARD;
+    int ret = -1;
+    KeyFrameIndex::Entry key;
+    key.pts = -1;
+    if (key_index && !(format_context->iformat->flags & AVFMT_NO_BYTE_SEEK)
+            && key_index->find(qreal(t)/qreal(AV_TIME_BASE), seek_type == AccurateSeek, &key)) {
+        ret = av_seek_frame(format_context, -1, key.pos, AVSEEK_FLAG_BYTE);
+        if (ret < 0) {
+            qWarning("[AVDemuxer] seek by byte error: %s", av_err2str(ret));
+            key.pts = -1;
+        } else {
+            qDebug("[AVDemuxer] key frame %f at byte %lld", key.pts, key.pos);
+        }
+    }
+    if (key.pts < 0)
+        ret = av_seek_frame(format_context, -1, t, seek_flag);
 #endif
     if (ret < 0) {
         qWarning("[AVDemuxer] seek error: %s", av_err2str(ret));
         return;
     }
+    seek_target = qreal(t)/qreal(AV_TIME_BASE);
+    //the key frame is the exact landing position
+    if (key.pts >= 0 && seek_type == KeyFrameSeek) {
+        seek_target = key.pts;
+        t = int64_t(key.pts*AV_TIME_BASE);
+    }
     //replay
     if (q == 0) {
         qDebug("************seek to 0. started = false");
         started_ = false;
-        v_codec_context->frame_number = 0; //TODO: why frame_number not changed after seek?
+        if (v_codec_context) //audio only
+            v_codec_context->frame_number = 0; //TODO: why frame_number not changed after seek?
     }
     if (master_clock) {
         master_clock->updateValue(qreal(t)/qreal(AV_TIME_BASE));
@@ -313,6 +501,68 @@ void AVDemuxer::seekBackward()
 
 bool AVDemuxer::loadFile(const QString &fileName)
 {
+    //not interrupted by the last cancelLoad() or setInterruptStatus()
+    __interrupt_status = 0;
+    return load(fileName);
+}
+
+void AVDemuxer::loadFileAsync(const QString &fileName)
+{
+    if (!load_thread) {
+        load_thread = new LoadThread(this);
+        connect(load_thread, SIGNAL(finished()), SLOT(onLoadThreadFinished()));
+    }
+    loading = true;
+    load_request = fileName;
+    if (load_thread->isRunning()) {
+        //the request is loaded when the thread finishes
+        __interrupt_status = 1;
+        return;
+    }
+    __interrupt_status = 0;
+    load_thread->file_name = load_request;
+    load_request = QString();
+    load_thread->start();
+}
+
+void AVDemuxer::cancelLoad()
+{
+    if (!loading)
+        return;
+    load_request = QString();
+    __interrupt_status = 1;
+}
+
+bool AVDemuxer::isLoading() const
+{
+    return loading;
+}
+
+void AVDemuxer::onLoadThreadFinished()
+{
+    if (!load_request.isEmpty()) {
+        //replaced by a new request
+        __interrupt_status = 0;
+        load_thread->file_name = load_request;
+        load_request = QString();
+        load_thread->start();
+        return;
+    }
+    loading = false;
+    //cancelled after the last interruptible step is still cancelled
+    const bool cancelled = __interrupt_status > 0;
+    if (cancelled)
+        qDebug("[AVDemuxer] loading %s is cancelled", qPrintable(load_thread->file_name));
+    __interrupt_status = 0; //readFrame() is not interrupted
+    emit loadFinished(load_ok && !cancelled);
+}
+
+bool AVDemuxer::load(const QString &fileName)
+{
+    QElapsedTimer load_timer;
+    load_timer.start();
+    open_time = info_time = load_time = 0;
+    info_cached = false;
     close();
     qDebug("all closed and reseted");
     _file_name = fileName;
@@ -330,30 +580,77 @@ bool AVDemuxer::loadFile(const QString &fileName)
 
     qDebug("avformat_open_input: format_context:'%p', url:'%s'...",format_context, qPrintable(_file_name));
 
+    //the probing limits. 0: FFmpeg's default
+    AVDictionary *options = 0;
+    const int probe = probe_size > 0 ? probe_size : (fast_open ? kFastProbeSize : 0);
+    const qint64 analyze = analyze_duration > 0 ? analyze_duration : (fast_open ? kFastAnalyzeDuration : 0);
+    const int fps_probe = fps_probe_size > 0 ? fps_probe_size : (fast_open ? kFastFpsProbeSize : 0);
+    if (probe > 0)
+        av_dict_set(&options, "probesize", QByteArray::number(probe).constData(), 0);
+    if (analyze > 0)
+        av_dict_set(&options, "analyzeduration", QByteArray::number(analyze).constData(), 0);
+    if (fps_probe > 0)
+        av_dict_set(&options, "fpsprobesize", QByteArray::number(fps_probe).constData(), 0);
+
+    if (read_ahead_size > 0) {
+        if (!read_ahead_io)
+            read_ahead_io = new ReadAheadIO();
+        //the protocol is interrupted by the timeout and the interrupt status too
+        if (read_ahead_io->open(_file_name, read_ahead_size, &format_context->interrupt_callback)) {
+            format_context->pb = read_ahead_io->context();
+            format_context->flags |= AVFMT_FLAG_CUSTOM_IO;
+            qDebug("[AVDemuxer] reading %s ahead. buffer: %d bytes", qPrintable(_file_name), read_ahead_size);
+        }
+    }
+    //local files. the format is still probed with the file name
+    if (!format_context->pb && mmap_enabled && QFileInfo(_file_name).isFile()) {
+        if (!mapped_io)
+            mapped_io = new MappedIO();
+        if (mapped_io->open(_file_name)) {
+            format_context->pb = mapped_io->context();
+            format_context->flags |= AVFMT_FLAG_CUSTOM_IO;
+            qDebug("[AVDemuxer] %s is memory mapped", qPrintable(_file_name));
+        }
+    }
+    emit loadProgress(OpeningInput);
     //start timeout timer and timeout
     __interrupt_timer.start();
 
-    int ret = avformat_open_input(&format_context, qPrintable(_file_name), NULL, NULL);
+    int ret = avformat_open_input(&format_context, qPrintable(_file_name), NULL, &options);
 
     //invalidate the timer
     __interrupt_timer.invalidate();
+    av_dict_free(&options);
+    open_time = load_timer.elapsed();
 
     qDebug("avformat_open_input: url:'%s' ret:%d",qPrintable(_file_name), ret);
 
     if (ret < 0) {
     //if (avformat_open_input(&format_context, qPrintable(filename), NULL, NULL)) {
         qWarning("Can't open video: %s", av_err2str(ret));
+        //format_context is freed. the custom io is not, stop reading ahead
+        close();
         return false;
     }
     format_context->flags |= AVFMT_FLAG_GENPTS;
     //deprecated
     //if(av_find_stream_info(format_context)<0) {
-    //TODO: avformat_find_stream_info is too slow, only useful for some video format
-    ret = avformat_find_stream_info(format_context, NULL);
-    if (ret < 0) {
-        qWarning("Can't find stream info: %s", av_err2str(ret));
-        return false;
+    //avformat_find_stream_info is slow. it's bounded by the probing limits and skipped if the info is cached
+    emit loadProgress(FindingStreamInfo);
+    info_cached = cache_info && StreamInfoCache::restore(format_context, _file_name);
+    if (!info_cached) {
+        //can be interrupted by __interrupt_cb too
+        ret = avformat_find_stream_info(format_context, NULL);
+        if (ret < 0) {
+            qWarning("Can't find stream info: %s", av_err2str(ret));
+            close(); //and the custom io
+            return false;
+        }
+        if (cache_info)
+            StreamInfoCache::store(format_context, _file_name);
     }
+    info_time = load_timer.elapsed() - open_time;
+    emit loadProgress(OpeningCodecs);
 
     //a_codec_context = format_context->streams[audioStream()]->codec;
     //v_codec_context = format_context->streams[videoStream()]->codec;
@@ -410,11 +707,26 @@ bool AVDemuxer::loadFile(const QString &fileName)
             /*codec_ctx->skip_frame =*/ v_codec_context->skip_loop_filter = v_codec_context->skip_idct = AVDISCARD_DEFAULT;
             v_codec_context->flags2 &= ~CODEC_FLAG2_FAST;
         //}
-            bool skipframes = false;
-            v_codec_context->skip_frame = skipframes ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+            //changed by VideoDecoder::setHurryUp() if video is late
+            v_codec_context->skip_frame = AVDISCARD_DEFAULT;
     }
     started_ = false;
-    return _has_audio || _has_vedio;
+    if (index_enabled && (_has_audio || _has_vedio)) {
+        if (!key_index)
+            key_index = new KeyFrameIndex();
+        key_index->build(_file_name, _has_vedio ? videoStream() : audioStream());
+    } else if (key_index) {
+        delete key_index;
+        key_index = 0;
+    }
+    load_time = load_timer.elapsed();
+    qDebug("[AVDemuxer] loaded in %lld ms. open: %lld ms, stream info: %lld ms%s", load_time, open_time, info_time
+           , info_cached ? " (cached)" : "");
+    if (!_has_audio && !_has_vedio) {
+        close(); //nothing to play. and the custom io
+        return false;
+    }
+    return true;
 }
 
 AVFormatContext* AVDemuxer::formatContext()
@@ -610,6 +922,66 @@ int AVDemuxer::subtitleStream() const
     return subtitle_stream;
 }
 
+QList<int> AVDemuxer::audioStreams() const
+{
+    return streams(AVMEDIA_TYPE_AUDIO);
+}
+
+QList<int> AVDemuxer::videoStreams() const
+{
+    return streams(AVMEDIA_TYPE_VIDEO);
+}
+
+QList<int> AVDemuxer::subtitleStreams() const
+{
+    return streams(AVMEDIA_TYPE_SUBTITLE);
+}
+
+bool AVDemuxer::setAudioStream(int index)
+{
+    if (!format_context) {
+        wanted_audio_stream = index;
+        return true;
+    }
+    //readFrame() checks the selected streams
+    QMutexLocker lock(&mutex);
+    Q_UNUSED(lock);
+    if (index >= 0 && !streams(AVMEDIA_TYPE_AUDIO).contains(index)) {
+        qWarning("[AVDemuxer] %d is not an audio stream", index);
+        return false;
+    }
+    wanted_audio_stream = index;
+    if (index < 0)
+        index = findStream(AVMEDIA_TYPE_AUDIO, -1, video_stream);
+    if (index < 0 || index == audio_stream)
+        return index >= 0;
+    AVCodecContext *ctx = format_context->streams[index]->codec;
+    AVCodec *aCodec = avcodec_find_decoder(ctx->codec_id);
+    if (!aCodec) {
+        qWarning("Unsupported audio codec. id=%d.", ctx->codec_id);
+        return false;
+    }
+    int ret = avcodec_open2(ctx, aCodec, NULL);
+    if (ret < 0) {
+        qWarning("open audio codec failed: %s", av_err2str(ret));
+        return false;
+    }
+    if (a_codec_context) {
+        qDebug("closing a_codec_context of stream %d", audio_stream);
+        avcodec_close(a_codec_context);
+    }
+    a_codec_context = ctx;
+    audio_stream = index;
+    discardUnusedStreams();
+    qDebug("[AVDemuxer] audio stream: %d", audio_stream);
+    return true;
+}
+
+void AVDemuxer::setVideoStream(int index)
+{
+    wanted_video_stream = index;
+}
+
 int AVDemuxer::width() const
 {
     return videoCodecContext()->width;
@@ -675,30 +1047,69 @@ bool AVDemuxer::findAVCodec()
 {
     if (video_stream != -2 && audio_stream != -2 && subtitle_stream != -2)
         return (video_stream != -1) && (audio_stream != -1) && (subtitle_stream != -1);
-    video_stream = audio_stream = subtitle_stream = -1;
-    AVMediaType type = AVMEDIA_TYPE_UNKNOWN;
-    for (unsigned int i=0; i<format_context->nb_streams; ++i) {
-        type = format_context->streams[i]->codec->codec_type;
-        if (type == AVMEDIA_TYPE_VIDEO && video_stream < 0) {
-            video_stream = i;
-            v_codec_context = format_context->streams[video_stream]->codec;
-            //if !vaapi
-            if (v_codec_context->codec_id == CODEC_ID_H264) {
-                v_codec_context->thread_type = FF_THREAD_FRAME; //FF_THREAD_SLICE;
-                v_codec_context->thread_count = QThread::idealThreadCount();
-            } else {
-                //v_codec_context->lowres = 0;
+    //the audio and subtitle streams are in the same program as the video stream, e.g. a multi-program MPEG-TS
+    video_stream = findStream(AVMEDIA_TYPE_VIDEO, wanted_video_stream, -1);
+    audio_stream = findStream(AVMEDIA_TYPE_AUDIO, wanted_audio_stream, video_stream);
+    subtitle_stream = findStream(AVMEDIA_TYPE_SUBTITLE, -1, audio_stream >= 0 ? audio_stream : video_stream);
+    if (video_stream >= 0) {
+        v_codec_context = format_context->streams[video_stream]->codec;
+        //if !vaapi
+        if (v_codec_context->codec_id == CODEC_ID_H264) {
+            v_codec_context->thread_type = FF_THREAD_FRAME; //FF_THREAD_SLICE;
+            v_codec_context->thread_count = QThread::idealThreadCount();
+        } else {
+            //v_codec_context->lowres = 0;
+        }
+    }
+    if (audio_stream >= 0)
+        a_codec_context = format_context->streams[audio_stream]->codec;
+    discardUnusedStreams();
+    return audio_stream >=0 && video_stream >= 0 && subtitle_stream >= 0;
+}
+
+int AVDemuxer::findStream(int type, int wanted, int related) const
+{
+    if (wanted >= 0 && !streams(type).contains(wanted)) {
+        qDebug("[AVDemuxer] stream %d is not found. select automatically", wanted);
+        wanted = -1;
+    }
+    int index = av_find_best_stream(format_context, (AVMediaType)type, wanted, related, NULL, 0);
+    if (index < 0 && related >= 0) //not in the related stream's program
+        index = av_find_best_stream(format_context, (AVMediaType)type, wanted, -1, NULL, 0);
+    return index < 0 ? -1 : index;
+}
+
+QList<int> AVDemuxer::streams(int type) const
+{
+    QList<int> indexes;
+    if (!format_context)
+        return indexes;
+    for (unsigned int i = 0; i < format_context->nb_streams; ++i) {
+        if (format_context->streams[i]->codec->codec_type == type)
+            indexes.append(i);
+    }
+    return indexes;
+}
+
+void AVDemuxer::discardUnusedStreams()
+{
+    //nothing decodes subtitles now, so the subtitle stream is discarded too
+    for (unsigned int i = 0; i < format_context->nb_streams; ++i) {
+        const bool used = (int)i == audio_stream || (int)i == video_stream;
+        format_context->streams[i]->discard = used ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+    }
+    //MPEG-TS does not parse the PIDs of the discarded programs
+    for (unsigned int i = 0; i < format_context->nb_programs; ++i) {
+        AVProgram *program = format_context->programs[i];
+        program->discard = AVDISCARD_ALL;
+        for (unsigned int j = 0; j < program->nb_stream_indexes; ++j) {
+            const int s = program->stream_index[j];
+            if (s == audio_stream || s == video_stream) {
+                program->discard = AVDISCARD_DEFAULT;
+                break;
             }
-        } else if (type == AVMEDIA_TYPE_AUDIO && audio_stream < 0) {
-            audio_stream = i;
-            a_codec_context = format_context->streams[audio_stream]->codec;
-        } else if (type == AVMEDIA_TYPE_SUBTITLE && subtitle_stream < 0) {
-            subtitle_stream = i;
         }
-        if (audio_stream >=0 && video_stream >= 0 && subtitle_stream >= 0)
-            return true;
     }
-    return false;
 }
 
 QString AVDemuxer::formatName(AVFormatContext *ctx, bool longName) const
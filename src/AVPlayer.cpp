@@ -52,7 +52,8 @@
 namespace QtAV {
 
 AVPlayer::AVPlayer(QObject *parent) :
-    QObject(parent),loaded(false),capture_dir("capture"),_renderer(0),_audio(0)
+    QObject(parent),loaded(false),play_on_load(false),capture_dir("capture"),_renderer(0),_audio(0)
+  ,ao_sample_rate(0),ao_channels(0),ao_opened_rate(0),ao_opened_channels(0)
   ,event_filter(0),video_capture(0)
 {
     qDebug("%s", aboutQtAV().toUtf8().constData());
@@ -87,6 +88,9 @@ AVPlayer::AVPlayer(QObject *parent) :
     demuxer_thread->setDemuxer(&demuxer);
     demuxer_thread->setAudioThread(audio_thread);
     demuxer_thread->setVideoThread(video_thread);
+    connect(demuxer_thread, SIGNAL(seekFinished(qreal)), this, SIGNAL(seekFinished(qreal)));
+    connect(&demuxer, SIGNAL(loadProgress(int)), this, SIGNAL(loadProgress(int)));
+    connect(&demuxer, SIGNAL(loadFinished(bool)), this, SLOT(onLoadFinished(bool)));
 
     setPlayerEventFilter(new EventFilter(this));
     setVideoCapture(new VideoCapture());
@@ -138,6 +142,12 @@ AudioOutput* AVPlayer::audio()
     return _audio;
 }
 
+void AVPlayer::setAudioOutputFormat(int sampleRate, int channels)
+{
+    ao_sample_rate = qMax(sampleRate, 0);
+    ao_channels = qMax(channels, 0);
+}
+
 void AVPlayer::setMute(bool mute)
 {
     if (_audio)
@@ -149,6 +159,131 @@ bool AVPlayer::isMute() const
     return !_audio || _audio->isMute();
 }
 
+void AVPlayer::setSpeed(qreal speed)
+{
+    speed = qBound<qreal>(0.25, speed, 4.0);
+    if (speed == clock->speed())
+        return;
+    qDebug("playback speed: %f", speed);
+    clock->setSpeed(speed);
+}
+
+qreal AVPlayer::speed() const
+{
+    return clock->speed();
+}
+
+void AVPlayer::setBufferBytes(int high, int low)
+{
+    audio_thread->packetQueue()->setBytesLimit(high, low);
+    video_thread->packetQueue()->setBytesLimit(high, low);
+}
+
+void AVPlayer::setBufferDuration(qreal high, qreal low)
+{
+    audio_thread->packetQueue()->setDurationLimit(high, low);
+    video_thread->packetQueue()->setDurationLimit(high, low);
+}
+
+int AVPlayer::droppedVideoFrames() const
+{
+    return video_thread->droppedFrames();
+}
+
+int AVPlayer::skippedVideoFrames() const
+{
+    return video_thread->skippedFrames();
+}
+
+qreal AVPlayer::videoSyncError() const
+{
+    return video_thread->syncError();
+}
+
+void AVPlayer::setSeekType(AVDemuxer::SeekType type)
+{
+    demuxer.setSeekType(type);
+}
+
+AVDemuxer::SeekType AVPlayer::seekType() const
+{
+    return demuxer.seekType();
+}
+
+void AVPlayer::setKeyFrameIndexEnabled(bool enabled)
+{
+    demuxer.setKeyFrameIndexEnabled(enabled);
+}
+
+bool AVPlayer::isKeyFrameIndexEnabled() const
+{
+    return demuxer.isKeyFrameIndexEnabled();
+}
+
+void AVPlayer::setFastOpen(bool fast)
+{
+    demuxer.setFastOpen(fast);
+    demuxer.setStreamInfoCacheEnabled(fast);
+}
+
+bool AVPlayer::isFastOpen() const
+{
+    return demuxer.isFastOpen();
+}
+
+void AVPlayer::setVideoConvertThreads(int threads)
+{
+    video_dec->setConvertThreads(threads);
+}
+
+int AVPlayer::videoConvertThreads() const
+{
+    return video_dec->convertThreads();
+}
+
+void AVPlayer::setReadAheadSize(int bytes)
+{
+    demuxer.setReadAheadSize(bytes);
+}
+
+int AVPlayer::readAheadSize() const
+{
+    return demuxer.readAheadSize();
+}
+
+QList<int> AVPlayer::audioStreams() const
+{
+    return demuxer.audioStreams();
+}
+
+int AVPlayer::audioStream() const
+{
+    if (!isLoaded())
+        return -1;
+    return demuxer.audioStream();
+}
+
+bool AVPlayer::setAudioStream(int index)
+{
+    if (!demuxer_thread->setAudioStream(index))
+        return false;
+    if (!demuxer_thread->isRunning())
+        aCodecCtx = demuxer.audioCodecContext();
+    return true;
+}
+
+qint64 AVPlayer::loadTime() const
+{
+    return demuxer.loadTime();
+}
+
+qint64 AVPlayer::seekLatency() const
+{
+    if (video_dec && video_dec->isAvailable())
+        return video_thread->seekLatency();
+    return audio_thread->seekLatency();
+}
+
 //setPlayerEventFilter(0) will remove the previous event filter
 void AVPlayer::setPlayerEventFilter(QObject *obj)
 {
@@ -292,30 +427,99 @@ bool AVPlayer::load()
         qDebug("No file to play...");
         return loaded;
     }
+    if (demuxer.isLoading()) {
+        qWarning("loading asynchronously. cancel it first");
+        return loaded;
+    }
     qDebug("loading: %s ...", path.toUtf8().constData());
     if (!demuxer.loadFile(path)) {
         return loaded;
     }
+    setupLoaded();
+    return loaded;
+}
+
+void AVPlayer::loadAsync(const QString &path)
+{
+    setFile(path);
+    loadAsync();
+}
+
+void AVPlayer::loadAsync()
+{
+    loaded = false;
+    if (path.isEmpty()) {
+        qDebug("No file to play...");
+        return;
+    }
+    //the threads use the demuxer and the codec contexts
+    if (isPlaying())
+        stop();
+    qDebug("loading asynchronously: %s ...", path.toUtf8().constData());
+    demuxer.loadFileAsync(path);
+}
+
+bool AVPlayer::isLoading() const
+{
+    return demuxer.isLoading();
+}
+
+void AVPlayer::cancelLoad()
+{
+    play_on_load = false;
+    demuxer.cancelLoad();
+}
+
+void AVPlayer::onLoadFinished(bool ok)
+{
+    loaded = false;
+    if (ok)
+        setupLoaded();
+    emit loadFinished(loaded);
+    if (play_on_load) {
+        play_on_load = false;
+        //not play() which reloads audio only files
+        if (loaded)
+            playLoaded();
+    }
+}
+
+void AVPlayer::setupLoaded()
+{
     loaded = true;
     demuxer.dump();
     formatCtx = demuxer.formatContext();
     aCodecCtx = demuxer.audioCodecContext();
     vCodecCtx = demuxer.videoCodecContext();
     if (_audio && aCodecCtx) {
-        _audio->setSampleRate(aCodecCtx->sample_rate);
-        _audio->setChannels(aCodecCtx->channels);
-        if (!_audio->open()) {
-            //return; //audio not ready
+        //keep the output open across files to avoid the reopen latency. AudioThread converts to its format
+        int rate = ao_sample_rate, channels = ao_channels;
+        if (rate <= 0)
+            rate = _audio->isOpen() ? ao_opened_rate : aCodecCtx->sample_rate;
+        if (channels <= 0)
+            channels = _audio->isOpen() ? ao_opened_channels : aCodecCtx->channels;
+        if (!_audio->isOpen() || rate != ao_opened_rate || channels != ao_opened_channels) {
+            _audio->setSampleRate(rate);
+            _audio->setChannels(channels);
+            ao_opened_rate = rate;
+            ao_opened_channels = channels;
+            if (!_audio->open()) {
+                //return; //audio not ready
+            }
         }
     }
     audio_dec->setCodecContext(aCodecCtx);
     video_dec->setCodecContext(vCodecCtx);
-    return loaded;
 }
 
 //FIXME: why no demuxer will not get an eof if replaying by seek(0)?
 void AVPlayer::play()
 {
+    if (demuxer.isLoading()) {
+        qDebug("play when loaded");
+        play_on_load = true;
+        return;
+    }
     if (isPlaying())
         stop();
     /*
@@ -331,8 +535,14 @@ void AVPlayer::play()
         qDebug("seek(0)");
         demuxer.seek(0); //FIXME: now assume it is seekable. for unseekable, setFile() again
     }
+    playLoaded();
+}
+
+void AVPlayer::playLoaded()
+{
     Q_ASSERT(clock != 0);
     clock->reset();
+    aCodecCtx = demuxer.audioCodecContext(); //switched when playing the last time
 
     if (aCodecCtx) {
         qDebug("Starting audio thread...");
@@ -365,6 +575,9 @@ void AVPlayer::stop()
             audio_thread->terminate();
         }
     }
+    //the output is kept open for the next file. do not play the rest of this one
+    if (_audio)
+        _audio->clear();
     if (video_thread->isRunning()) {
         qDebug("stopv");
         video_thread->stop();
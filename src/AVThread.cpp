@@ -21,8 +21,26 @@
 
 #include <QtAV/AVThread.h>
 #include <private/AVThread_p.h>
+#include <QtAV/AVClock.h>
+#include <QtCore/QElapsedTimer>
 
 namespace QtAV {
+
+static const qreal kWaitSlice = 0.02; //seconds. see waitForClock()
+
+//started once. Q_GLOBAL_STATIC is thread safe, a lazy start() in the threads is not
+class SeekTimer : public QElapsedTimer
+{
+public:
+    SeekTimer() { start(); }
+};
+Q_GLOBAL_STATIC(SeekTimer, seekTimer)
+
+//monotonic msecs shared by all threads
+static qint64 seekClock()
+{
+    return seekTimer()->elapsed();
+}
 AVThread::AVThread(QObject *parent) :
     QThread(parent)
 {
@@ -107,6 +125,43 @@ void AVThread::setDemuxEnded(bool ended)
     d_func().demux_end = ended;
 }
 
+void AVThread::clearBuffers()
+{
+    d_func().packets.clear();
+}
+
+void AVThread::flush(int serial, qreal target)
+{
+    DPTR_D(AVThread);
+    d.serial = serial; //before clearing, the packets taken meanwhile are stale
+    clearBuffers();
+    d.seek_latency = -1;
+    d.seek_time = seekClock(); //read by this thread after the flush packet is taken
+    Packet pkt;
+    pkt.pts = target;
+    pkt.serial = serial;
+    d.packets.put(pkt);
+}
+
+void AVThread::setSerial(int serial)
+{
+    DPTR_D(AVThread);
+    d.serial = serial;
+    d.keep_serial = true;
+}
+
+qint64 AVThread::seekLatency() const
+{
+    return d_func().seek_latency;
+}
+
+void AVThread::finishSeek()
+{
+    DPTR_D(AVThread);
+    d.seek_latency = seekClock() - d.seek_time;
+    qDebug("seek finished in %lld ms", d.seek_latency);
+}
+
 void AVThread::resetState()
 {
     DPTR_D(AVThread);
@@ -115,10 +170,29 @@ void AVThread::resetState()
         d.writer->pause(false); //stop waiting. Important when replay
     d.stop = false;
     d.demux_end = false;
+    //AVDemuxThread starts from 0 too, unless the thread is restarted by setSerial() in the same session
+    if (!d.keep_serial)
+        d.serial = 0;
+    d.keep_serial = false;
+    d.decoder_serial = d.serial; //the decoder is flushed when the thread starts
     d.packets.setBlocking(true);
     d.packets.clear();
 }
 
+qreal AVThread::waitForClock(qreal pts, int serial)
+{
+    DPTR_D(AVThread);
+    qreal delay = pts - d.clock->value();
+    qreal left = delay/d.clock->speed(); //real time
+    while (delay > kSyncThreshold && left > 0 && !d.stop && serial == d.serial) {
+        const qreal t = qMin(qMin(delay/d.clock->speed(), left), kWaitSlice);
+        usleep((unsigned long)(t*1000000.0));
+        left -= t;
+        delay = pts - d.clock->value();
+    }
+    return delay;
+}
+
 bool AVThread::tryPause()
 {
     DPTR_D(AVThread);
@@ -21,6 +21,8 @@
 
 #include <QtAV/AudioDecoder.h>
 #include <private/AVDecoder_p.h>
+#include <private/AudioSampleConverter_p.h>
+#include <QtAV/Packet.h>
 #include <QtAV/QtAV_Compat.h>
 
 namespace QtAV {
@@ -29,6 +31,7 @@ class AudioDecoderPrivate : public AVDecoderPrivate
 {
 public:
     //AudioDecoderPrivate();
+    AudioSampleConverter converter; //to interleaved float
 };
 
 AudioDecoder::AudioDecoder()
@@ -37,18 +40,27 @@ AudioDecoder::AudioDecoder()
 
 }
 
-//
 bool AudioDecoder::decode(const QByteArray &encoded)
 {
     if (!isAvailable())
         return false;
-    DPTR_D(AudioDecoder);
+    //the decoder may read beyond the end of payload. av_new_packet() allocates the padding
     AVPacket packet;
-    av_new_packet(&packet, encoded.size());
-    memcpy(packet.data, encoded.data(), encoded.size());
-//TODO: use AVPacket directly instead of Packet?
-    int ret = avcodec_decode_audio4(d.codec_ctx, d.frame, &d.got_frame_ptr, &packet);
-    av_free_packet(&packet);
+    if (av_new_packet(&packet, encoded.size()) < 0)
+        return false;
+    memcpy(packet.data, encoded.constData(), encoded.size());
+    return decode(Packet::fromAVPacket(&packet, 1.0));
+}
+
+bool AudioDecoder::decode(const Packet &packet)
+{
+    if (!isAvailable())
+        return false;
+    if (!packet.asAVPacket())
+        return decode(packet.data);
+    DPTR_D(AudioDecoder);
+    //the demuxed packet is used directly. flags, side data and padding are kept
+    int ret = avcodec_decode_audio4(d.codec_ctx, d.frame, &d.got_frame_ptr, packet.asAVPacket());
     if (ret < 0) {
         qWarning("[AudioDecoder] %s", av_err2str(ret));
         return false;
@@ -57,113 +69,21 @@ bool AudioDecoder::decode(const QByteArray &encoded)
         qWarning("[AudioDecoder] got_frame_ptr=false");
         return false;
     }
-    int samples_with_channels = d.frame->nb_samples * d.codec_ctx->channels;
-    int samples_with_channels_half = samples_with_channels/2;
-    d.decoded.resize(samples_with_channels * sizeof(float));
-    float *decoded_data = (float*)d.decoded.data();
-    static const float kInt8_inv = 1.0f/128.0f;
-    static const float kInt16_inv = 1.0f/32768.0f;
-    static const float kInt32_inv = 1.0f/2147483648.0f;
+    const int channels = d.codec_ctx->channels;
+    //the last decoded data may be still used by the consumer. allocate a new buffer instead of detaching(copying) it
+    if (!d.decoded.isDetached())
+        d.decoded = QByteArray();
+    d.decoded.resize(d.frame->nb_samples * channels * sizeof(float));
     //TODO: hwa
     //https://code.google.com/p/lavfilters/source/browse/decoder/LAVAudio/LAVAudio.cpp
-    switch (d.codec_ctx->sample_fmt) {
-    case AV_SAMPLE_FMT_U8:
-    {
-        uint8_t *data = (uint8_t*)*d.frame->data;
-        for (int i = 0; i < samples_with_channels_half; i++) {
-            decoded_data[i] = (data[i] - 0x7F) * kInt8_inv;
-            decoded_data[samples_with_channels - i] = (data[samples_with_channels - i] - 0x7F) * kInt8_inv;
-        }
-    }
-        break;
-    case AV_SAMPLE_FMT_S16:
-    {
-        int16_t *data = (int16_t*)*d.frame->data;
-        for (int i = 0; i < samples_with_channels_half; i++) {
-            decoded_data[i] = data[i] * kInt16_inv;
-            decoded_data[samples_with_channels - i] = data[samples_with_channels - i] * kInt16_inv;
-        }
-    }
-        break;
-    case AV_SAMPLE_FMT_S32:
-    {
-        int32_t *data = (int32_t*)*d.frame->data;
-        for (int i = 0; i < samples_with_channels_half; i++) {
-            decoded_data[i] = data[i] * kInt32_inv;
-            decoded_data[samples_with_channels - i] = data[samples_with_channels - i] * kInt32_inv;
-        }
-    }
-        break;
-    case AV_SAMPLE_FMT_FLT:
-        memcpy(decoded_data, *d.frame->data, d.decoded.size());
-        break;
-    case AV_SAMPLE_FMT_DBL:
-    {
-        double *data = (double*)*d.frame->data;
-        for (int i = 0; i < samples_with_channels_half; i++) {
-            decoded_data[i] = data[i];
-            decoded_data[samples_with_channels - i] = data[samples_with_channels - i];
-        }
-    }
-        break;
-    case AV_SAMPLE_FMT_U8P:
-    {
-        uint8_t **data = (uint8_t**)d.frame->extended_data;
-        for (int i = 0; i < d.frame->nb_samples; ++i) {
-            for (int ch = 0; ch < d.codec_ctx->channels; ++ch) {
-                *decoded_data++ = (data[ch][i] - 0x7F) * kInt8_inv;
-            }
-        }
-    }
-        break;
-    case AV_SAMPLE_FMT_S16P:
-    {
-        uint16_t **data = (uint16_t**)d.frame->extended_data;
-        for (int i = 0; i < d.frame->nb_samples; ++i) {
-            for (int ch = 0; ch < d.codec_ctx->channels; ++ch) {
-                *decoded_data++ = data[ch][i] * kInt16_inv;
-            }
-        }
-    }
-        break;
-    case AV_SAMPLE_FMT_S32P:
-    {
-        uint32_t **data = (uint32_t**)d.frame->extended_data;
-        for (int i = 0; i < d.frame->nb_samples; ++i) {
-            for (int ch = 0; ch < d.codec_ctx->channels; ++ch) {
-                *decoded_data++ = data[ch][i] * kInt32_inv;
-            }
-        }
-    }
-        break;
-    case AV_SAMPLE_FMT_FLTP:
-    {
-        float **data = (float**)d.frame->extended_data;
-        for (int i = 0; i < d.frame->nb_samples; ++i) {
-            for (int ch = 0; ch < d.codec_ctx->channels; ++ch) {
-                *decoded_data++ = data[ch][i];
-            }
-        }
-    }
-        break;
-    case AV_SAMPLE_FMT_DBLP:
-    {
-        double **data = (double**)d.frame->extended_data;
-        for (int i = 0; i < d.frame->nb_samples; ++i) {
-            for (int ch = 0; ch < d.codec_ctx->channels; ++ch) {
-                *decoded_data++ = data[ch][i];
-            }
-        }
-    }
-        break;
-    default:
+    if (!d.converter.toFloat(d.codec_ctx->sample_fmt, d.frame->extended_data, channels, d.frame->nb_samples
+                             , (float*)d.decoded.data())) {
         static bool sWarn_a_fmt = true; //FIXME: no warning when replay. warn only once
         if (sWarn_a_fmt) {
             qWarning("Unsupported audio format: %d", d.codec_ctx->sample_fmt);
             sWarn_a_fmt = false;
         }
         d.decoded.clear();
-        break;
     }
 /*
     if ( pts )
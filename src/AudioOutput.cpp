@@ -80,4 +80,18 @@ bool AudioOutput::isMute() const
     return !isAvailable() || d_func().mute;
 }
 
+bool AudioOutput::isOpen() const
+{
+    return d_func().opened;
+}
+
+qreal AudioOutput::latency() const
+{
+    return 0;
+}
+
+void AudioOutput::clear()
+{
+}
+
 } //namespace QtAV
@@ -0,0 +1,129 @@
+/******************************************************************************
+    QtAV:  Media play library based on Qt and FFmpeg
+    Copyright (C) 2012-2013 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+
+#include <private/AudioResampler_p.h>
+#include <QtAV/QtAV_Compat.h>
+extern "C" {
+#include <libswresample/swresample.h>
+}
+
+namespace QtAV {
+
+AudioResampler::AudioResampler()
+    :context(0),dirty(true),in_rate(0),in_channels(0),in_layout(0),out_rate(0),out_channels(0)
+{
+}
+
+AudioResampler::~AudioResampler()
+{
+    if (context)
+        swr_free(&context);
+}
+
+void AudioResampler::setInFormat(int sampleRate, int channels, qint64 channelLayout)
+{
+    //the layout is not reliable, e.g. not set by some decoders
+    if (channelLayout == 0 || av_get_channel_layout_nb_channels(channelLayout) != channels)
+        channelLayout = av_get_default_channel_layout(channels);
+    if (in_rate == sampleRate && in_channels == channels && in_layout == channelLayout)
+        return;
+    in_rate = sampleRate;
+    in_channels = channels;
+    in_layout = channelLayout;
+    dirty = true;
+}
+
+void AudioResampler::setOutFormat(int sampleRate, int channels)
+{
+    if (out_rate == sampleRate && out_channels == channels)
+        return;
+    out_rate = sampleRate;
+    out_channels = channels;
+    dirty = true;
+}
+
+bool AudioResampler::isPassThrough() const
+{
+    return in_rate == out_rate && in_channels == out_channels;
+}
+
+void AudioResampler::reset()
+{
+    dirty = true;
+}
+
+bool AudioResampler::prepare()
+{
+    if (context)
+        swr_free(&context);
+    dirty = false;
+    if (isPassThrough())
+        return true;
+    if (in_rate <= 0 || in_channels <= 0 || out_rate <= 0 || out_channels <= 0)
+        return false;
+    context = swr_alloc_set_opts(NULL
+                                 , av_get_default_channel_layout(out_channels), AV_SAMPLE_FMT_FLT, out_rate
+                                 , in_layout, AV_SAMPLE_FMT_FLT, in_rate
+                                 , 0, NULL);
+    if (!context) {
+        qWarning("[AudioResampler] alloc context failed");
+        return false;
+    }
+    int ret = swr_init(context);
+    if (ret < 0) {
+        qWarning("[AudioResampler] %s", av_err2str(ret));
+        swr_free(&context);
+        return false;
+    }
+    qDebug("[AudioResampler] %dHz %d channels => %dHz %d channels", in_rate, in_channels, out_rate, out_channels);
+    return true;
+}
+
+bool AudioResampler::convert(const QByteArray &in, QByteArray *out)
+{
+    if (dirty && !prepare())
+        return false;
+    if (isPassThrough()) {
+        *out = in;
+        return true;
+    }
+    if (!context)
+        return false;
+    const int in_samples = in.size()/(in_channels*sizeof(float));
+    const int out_samples = av_rescale_rnd(swr_get_delay(context, in_rate) + in_samples, out_rate, in_rate, AV_ROUND_UP);
+    //the last output may be still used by the consumer. allocate a new buffer instead of detaching(copying) it
+    if (!out->isDetached())
+        *out = QByteArray();
+    out->resize(out_samples*out_channels*sizeof(float));
+    uint8_t *dst = (uint8_t*)out->data();
+    const uint8_t *src = (const uint8_t*)in.constData();
+    const int samples = swr_convert(context, &dst, out_samples, &src, in_samples);
+    if (samples < 0) {
+        qWarning("[AudioResampler] %s", av_err2str(samples));
+        out->clear();
+        return false;
+    }
+    out->resize(samples*out_channels*sizeof(float));
+    return true;
+}
+
+} //namespace QtAV
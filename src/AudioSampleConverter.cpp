@@ -0,0 +1,385 @@
+/******************************************************************************
+    QtAV:  Media play library based on Qt and FFmpeg
+    Copyright (C) 2012-2013 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+
+#include <private/AudioSampleConverter_p.h>
+#include <private/SIMD_p.h>
+#include <QtAV/QtAV_Compat.h>
+#include <string.h>
+extern "C" {
+#include <libavutil/cpu.h>
+}
+
+/*
+ * A packed format is converted directly. A planar format is converted in blocks: each plane of a block is
+ * converted to float by the packed kernel into a small buffer in cache, then the floats are interleaved.
+ * 2, 4 and 8 channels(stereo, quad, 7.1) are interleaved by SIMD transposition, others by C.
+ */
+
+namespace QtAV {
+
+static const float kInt8_inv = 1.0f/128.0f;
+static const float kInt16_inv = 1.0f/32768.0f;
+static const float kInt32_inv = 1.0f/2147483648.0f;
+//floats of a planar block. 16KB, in L1 cache
+static const int kBlockFloats = 4096;
+
+//n samples of a packed format to float
+typedef void (*ToFloatFunc)(const void *in, float *out, int n);
+//planes: channels pointers of samples floats
+typedef void (*InterleaveFunc)(const float *const planes[], int channels, int samples, float *out);
+
+static void u8_to_float_C(const void *in, float *out, int n)
+{
+    const quint8 *s = (const quint8*)in;
+    for (int i = 0; i < n; ++i)
+        out[i] = float(s[i] - 0x80) * kInt8_inv;
+}
+
+static void s16_to_float_C(const void *in, float *out, int n)
+{
+    const qint16 *s = (const qint16*)in;
+    for (int i = 0; i < n; ++i)
+        out[i] = float(s[i]) * kInt16_inv;
+}
+
+static void s32_to_float_C(const void *in, float *out, int n)
+{
+    const qint32 *s = (const qint32*)in;
+    for (int i = 0; i < n; ++i)
+        out[i] = float(s[i]) * kInt32_inv;
+}
+
+static void dbl_to_float_C(const void *in, float *out, int n)
+{
+    const double *s = (const double*)in;
+    for (int i = 0; i < n; ++i)
+        out[i] = float(s[i]);
+}
+
+static void interleave_C(const float *const planes[], int channels, int samples, float *out)
+{
+    for (int i = 0; i < samples; ++i) {
+        for (int ch = 0; ch < channels; ++ch)
+            *out++ = planes[ch][i];
+    }
+}
+
+#if QTAV_HAVE_SSE2
+//x: 4 int32
+QTAV_TARGET("sse2") static inline void store_scaled_SSE2(float *out, __m128i x, __m128 scale)
+{
+    _mm_storeu_ps(out, _mm_mul_ps(_mm_cvtepi32_ps(x), scale));
+}
+
+QTAV_TARGET("sse2") static void u8_to_float_SSE2(const void *in, float *out, int n)
+{
+    const quint8 *s = (const quint8*)in;
+    const __m128 scale = _mm_set1_ps(kInt8_inv);
+    const __m128i k80 = _mm_set1_epi8((char)0x80);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        //x^0x80 is x-128 in int8. unpack to the high byte then shift arithmetically to sign extend
+        const __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(s + i)), k80);
+        const __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(x, x), 8);
+        const __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(x, x), 8);
+        store_scaled_SSE2(out + i, _mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16), scale);
+        store_scaled_SSE2(out + i + 4, _mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16), scale);
+        store_scaled_SSE2(out + i + 8, _mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16), scale);
+        store_scaled_SSE2(out + i + 12, _mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16), scale);
+    }
+    u8_to_float_C(s + i, out + i, n - i);
+}
+
+QTAV_TARGET("sse2") static void s16_to_float_SSE2(const void *in, float *out, int n)
+{
+    const qint16 *s = (const qint16*)in;
+    const __m128 scale = _mm_set1_ps(kInt16_inv);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i x = _mm_loadu_si128((const __m128i*)(s + i));
+        store_scaled_SSE2(out + i, _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16), scale);
+        store_scaled_SSE2(out + i + 4, _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16), scale);
+    }
+    s16_to_float_C(s + i, out + i, n - i);
+}
+
+QTAV_TARGET("sse2") static void s32_to_float_SSE2(const void *in, float *out, int n)
+{
+    const qint32 *s = (const qint32*)in;
+    const __m128 scale = _mm_set1_ps(kInt32_inv);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        store_scaled_SSE2(out + i, _mm_loadu_si128((const __m128i*)(s + i)), scale);
+        store_scaled_SSE2(out + i + 4, _mm_loadu_si128((const __m128i*)(s + i + 4)), scale);
+    }
+    s32_to_float_C(s + i, out + i, n - i);
+}
+
+QTAV_TARGET("sse2") static void dbl_to_float_SSE2(const void *in, float *out, int n)
+{
+    const double *s = (const double*)in;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(s + i));
+        const __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(s + i + 2));
+        _mm_storeu_ps(out + i, _mm_movelh_ps(lo, hi));
+    }
+    dbl_to_float_C(s + i, out + i, n - i);
+}
+
+//4 samples of 4 channels: rows are channels in, samples out
+QTAV_TARGET("sse2") static inline void transpose4_SSE2(__m128 &r0, __m128 &r1, __m128 &r2, __m128 &r3)
+{
+    const __m128 t0 = _mm_unpacklo_ps(r0, r1); //00 10 01 11
+    const __m128 t1 = _mm_unpacklo_ps(r2, r3); //20 30 21 31
+    const __m128 t2 = _mm_unpackhi_ps(r0, r1); //02 12 03 13
+    const __m128 t3 = _mm_unpackhi_ps(r2, r3); //22 32 23 33
+    r0 = _mm_movelh_ps(t0, t1);
+    r1 = _mm_movehl_ps(t1, t0);
+    r2 = _mm_movelh_ps(t2, t3);
+    r3 = _mm_movehl_ps(t3, t2);
+}
+
+QTAV_TARGET("sse2") static void interleave_SSE2(const float *const planes[], int channels, int samples, float *out)
+{
+    int i = 0;
+    if (channels == 1) {
+        memcpy(out, planes[0], samples*sizeof(float));
+        return;
+    } else if (channels == 2) {
+        const float *l = planes[0], *r = planes[1];
+        for (; i + 4 <= samples; i += 4) {
+            const __m128 a = _mm_loadu_ps(l + i);
+            const __m128 b = _mm_loadu_ps(r + i);
+            _mm_storeu_ps(out + 2*i, _mm_unpacklo_ps(a, b));
+            _mm_storeu_ps(out + 2*i + 4, _mm_unpackhi_ps(a, b));
+        }
+    } else if (channels == 4 || channels == 8) {
+        for (; i + 4 <= samples; i += 4) {
+            for (int ch = 0; ch < channels; ch += 4) {
+                __m128 r0 = _mm_loadu_ps(planes[ch] + i);
+                __m128 r1 = _mm_loadu_ps(planes[ch + 1] + i);
+                __m128 r2 = _mm_loadu_ps(planes[ch + 2] + i);
+                __m128 r3 = _mm_loadu_ps(planes[ch + 3] + i);
+                transpose4_SSE2(r0, r1, r2, r3);
+                float *d = out + i*channels + ch;
+                _mm_storeu_ps(d, r0);
+                _mm_storeu_ps(d + channels, r1);
+                _mm_storeu_ps(d + 2*channels, r2);
+                _mm_storeu_ps(d + 3*channels, r3);
+            }
+        }
+    }
+    for (; i < samples; ++i) {
+        for (int ch = 0; ch < channels; ++ch)
+            out[i*channels + ch] = planes[ch][i];
+    }
+}
+#endif //QTAV_HAVE_SSE2
+
+#if QTAV_HAVE_AVX2
+QTAV_TARGET("avx2") static inline void store_scaled_AVX2(float *out, __m256i x, __m256 scale)
+{
+    _mm256_storeu_ps(out, _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale));
+}
+
+QTAV_TARGET("avx2") static void u8_to_float_AVX2(const void *in, float *out, int n)
+{
+    const quint8 *s = (const quint8*)in;
+    const __m256 scale = _mm256_set1_ps(kInt8_inv);
+    const __m256i k80 = _mm256_set1_epi32(0x80);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m256i lo = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(s + i)));
+        const __m256i hi = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(s + i + 8)));
+        store_scaled_AVX2(out + i, _mm256_sub_epi32(lo, k80), scale);
+        store_scaled_AVX2(out + i + 8, _mm256_sub_epi32(hi, k80), scale);
+    }
+    u8_to_float_C(s + i, out + i, n - i);
+}
+
+QTAV_TARGET("avx2") static void s16_to_float_AVX2(const void *in, float *out, int n)
+{
+    const qint16 *s = (const qint16*)in;
+    const __m256 scale = _mm256_set1_ps(kInt16_inv);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        store_scaled_AVX2(out + i, _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(s + i))), scale);
+        store_scaled_AVX2(out + i + 8, _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(s + i + 8))), scale);
+    }
+    s16_to_float_C(s + i, out + i, n - i);
+}
+
+QTAV_TARGET("avx2") static void s32_to_float_AVX2(const void *in, float *out, int n)
+{
+    const qint32 *s = (const qint32*)in;
+    const __m256 scale = _mm256_set1_ps(kInt32_inv);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        store_scaled_AVX2(out + i, _mm256_loadu_si256((const __m256i*)(s + i)), scale);
+        store_scaled_AVX2(out + i + 8, _mm256_loadu_si256((const __m256i*)(s + i + 8)), scale);
+    }
+    s32_to_float_C(s + i, out + i, n - i);
+}
+
+QTAV_TARGET("avx2") static void dbl_to_float_AVX2(const void *in, float *out, int n)
+{
+    const double *s = (const double*)in;
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128 lo = _mm256_cvtpd_ps(_mm256_loadu_pd(s + i));
+        const __m128 hi = _mm256_cvtpd_ps(_mm256_loadu_pd(s + i + 4));
+        _mm256_storeu_ps(out + i, _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1));
+    }
+    dbl_to_float_C(s + i, out + i, n - i);
+}
+#endif //QTAV_HAVE_AVX2
+
+struct SampleKernels
+{
+    SampleKernels(AudioSampleConverter::Kernels k)
+        :kernels(AudioSampleConverter::C)
+        ,u8(u8_to_float_C),s16(s16_to_float_C),s32(s32_to_float_C),dbl(dbl_to_float_C),interleave(interleave_C) {
+        if (k == AudioSampleConverter::C)
+            return;
+        const int flags = av_get_cpu_flags();
+        Q_UNUSED(flags);
+#if QTAV_HAVE_SSE2
+        if (flags & AV_CPU_FLAG_SSE2) {
+            kernels = AudioSampleConverter::SSE2;
+            u8 = u8_to_float_SSE2;
+            s16 = s16_to_float_SSE2;
+            s32 = s32_to_float_SSE2;
+            dbl = dbl_to_float_SSE2;
+            interleave = interleave_SSE2;
+        }
+#endif
+        if (k == AudioSampleConverter::SSE2)
+            return;
+#if QTAV_HAVE_AVX2 && defined(AV_CPU_FLAG_AVX2)
+        if (flags & AV_CPU_FLAG_AVX2) {
+            //interleaving is limited by the stores. SSE2 is enough
+            kernels = AudioSampleConverter::AVX2;
+            u8 = u8_to_float_AVX2;
+            s16 = s16_to_float_AVX2;
+            s32 = s32_to_float_AVX2;
+            dbl = dbl_to_float_AVX2;
+        }
+#endif
+    }
+    AudioSampleConverter::Kernels kernels; //the kernels actually used
+    ToFloatFunc u8, s16, s32, dbl;
+    InterleaveFunc interleave;
+};
+
+struct SampleKernelTables
+{
+    SampleKernelTables()
+        :c(AudioSampleConverter::C),sse2(AudioSampleConverter::SSE2),best(AudioSampleConverter::Auto) {}
+    SampleKernels c, sse2, best;
+};
+Q_GLOBAL_STATIC(SampleKernelTables, sampleKernelTables)
+
+static const SampleKernels& sampleKernels(AudioSampleConverter::Kernels k)
+{
+    const SampleKernelTables *t = sampleKernelTables();
+    if (k == AudioSampleConverter::C)
+        return t->c;
+    if (k == AudioSampleConverter::SSE2)
+        return t->sse2;
+    return t->best;
+}
+
+static void flt_to_float(const void *in, float *out, int n)
+{
+    memcpy(out, in, n*sizeof(float));
+}
+
+AudioSampleConverter::AudioSampleConverter(Kernels kernels)
+    :kernels_(kernels)
+{
+}
+
+AudioSampleConverter::Kernels AudioSampleConverter::kernels() const
+{
+    return sampleKernels(kernels_).kernels;
+}
+
+bool AudioSampleConverter::toFloat(int sampleFormat, const quint8 *const in[], int channels, int samples, float *out) const
+{
+    const SampleKernels &k = sampleKernels(kernels_);
+    ToFloatFunc to_float = 0;
+    int bytes = 0; //bytes per sample
+    bool planar = false;
+    switch (sampleFormat) {
+    case AV_SAMPLE_FMT_U8P:  planar = true; //fall through
+    case AV_SAMPLE_FMT_U8:   to_float = k.u8; bytes = 1; break;
+    case AV_SAMPLE_FMT_S16P: planar = true; //fall through
+    case AV_SAMPLE_FMT_S16:  to_float = k.s16; bytes = 2; break;
+    case AV_SAMPLE_FMT_S32P: planar = true; //fall through
+    case AV_SAMPLE_FMT_S32:  to_float = k.s32; bytes = 4; break;
+    case AV_SAMPLE_FMT_FLTP: planar = true; //fall through
+    case AV_SAMPLE_FMT_FLT:  to_float = flt_to_float; bytes = 4; break;
+    case AV_SAMPLE_FMT_DBLP: planar = true; //fall through
+    case AV_SAMPLE_FMT_DBL:  to_float = k.dbl; bytes = 8; break;
+    default:
+        return false;
+    }
+    if (channels <= 0 || samples < 0)
+        return false;
+    if (!planar || channels == 1) {
+        to_float(in[0], out, samples*channels);
+        return true;
+    }
+    if (sampleFormat == AV_SAMPLE_FMT_FLTP) {
+        k.interleave((const float *const *)in, channels, samples, out);
+        return true;
+    }
+    const int block = (kBlockFloats/channels) & ~15;
+    if (block <= 0) { //too many channels
+        float tmp[kBlockFloats];
+        const int n = kBlockFloats;
+        for (int ch = 0; ch < channels; ++ch) {
+            for (int i = 0; i < samples; i += n) {
+                const int count = qMin(n, samples - i);
+                to_float(in[ch] + i*bytes, tmp, count);
+                float *d = out + i*channels + ch;
+                for (int j = 0; j < count; ++j, d += channels)
+                    *d = tmp[j];
+            }
+        }
+        return true;
+    }
+    float tmp[kBlockFloats];
+    const float *planes[kBlockFloats/16];
+    for (int ch = 0; ch < channels; ++ch)
+        planes[ch] = tmp + ch*block;
+    for (int i = 0; i < samples; i += block) {
+        const int count = qMin(block, samples - i);
+        for (int ch = 0; ch < channels; ++ch)
+            to_float(in[ch] + i*bytes, tmp + ch*block, count);
+        k.interleave(planes, channels, count, out + i*channels);
+    }
+    return true;
+}
+
+} //namespace QtAV
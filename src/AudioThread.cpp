@@ -21,6 +21,8 @@
 
 #include <QtAV/AudioThread.h>
 #include <private/AVThread_p.h>
+#include <private/AudioResampler_p.h>
+#include <private/AudioTimeStretch_p.h>
 #include <QtAV/AudioDecoder.h>
 #include <QtAV/Packet.h>
 #include <QtAV/AudioOutput.h>
@@ -34,6 +36,10 @@ class AudioThreadPrivate : public AVThreadPrivate
 {
 public:
     qreal last_pts; //used when audio output is not available, to calculate the aproximate sleeping time
+    AudioResampler resampler; //stream format => output format
+    QByteArray resampled;
+    AudioTimeStretch stretch; //clock speed, pitch is not changed
+    QByteArray stretched;
 };
 
 AudioThread::AudioThread(QObject *parent)
@@ -57,9 +63,22 @@ void AudioThread::run()
     AudioOutput *ao = static_cast<AudioOutput*>(d.writer);
     int sample_rate = dec->codecContext()->sample_rate;
     int channels = dec->codecContext()->channels;
+    d.resampler.setInFormat(sample_rate, channels, dec->codecContext()->channel_layout);
+    //the output is opened once with a fixed format. resample and remix to it
+    if (ao && ao->isAvailable()) {
+        sample_rate = ao->sampleRate();
+        channels = ao->channels();
+    }
+    d.resampler.setOutFormat(sample_rate, channels);
+    d.resampler.reset();
+    d.stretch.setFormat(sample_rate, channels);
+    d.stretch.reset();
     int csf = channels * sample_rate * sizeof(float);
     static const double max_len = 0.02;
     d.last_pts = 0;
+    d.seek_target = -1;
+    dec->flush(); //may be used by the last playback
+    bool seeked = false; //the next output is the first after seeking
     //TODO: bool need_sync in private class
     bool is_external_clock = d.clock->clockType() == AVClock::ExternalClock;
     while (!d.stop) {
@@ -77,48 +96,74 @@ void AudioThread::run()
             }
         }
         Packet pkt = d.packets.take(); //wait to dequeue
+        if (pkt.serial != d.serial) //taken before flush() cleared the queue, or an older flush packet
+            continue;
         if (!pkt.isValid()) {
-            qDebug("Invalid packet! flush audio codec context!!!!!!!!");
+            if (pkt.serial == d.decoder_serial) //end marker
+                continue;
+            qDebug("flush audio codec context for seek serial %d", pkt.serial);
+            d.decoder_serial = pkt.serial;
             dec->flush();
+            d.resampler.reset();
+            d.stretch.reset();
+            //the samples before seeking are not played, and not counted in the latency
+            if (ao && ao->isAvailable())
+                ao->clear();
+            d.seek_target = pkt.pts; //the flush packet of an accurate seek carries the target
+            seeked = true;
             continue;
         }
+        const qreal speed = d.clock->speed();
         if (is_external_clock) {
             d.delay = pkt.pts  - d.clock->value();
-            /*
-             *after seeking forward, a packet may be the old, v packet may be
-             *the new packet, then the d.delay is very large, omit it.
-             *TODO: 1. how to choose the value
-             * 2. use last delay when seeking
-            */
-            if (qAbs(d.delay) < 2.718) {
-                if (d.delay > kSyncThreshold) { //Slow down
-                    //d.delay_cond.wait(&d.mutex, d.delay*1000); //replay may fail. why?
-                    //qDebug("~~~~~wating for %f msecs", d.delay*1000);
-                    usleep(d.delay * 1000000);
-                } else if (d.delay < -kSyncThreshold) { //Speed up. drop frame?
-                    //continue;
-                }
-            } else { //when to drop off?
-                qDebug("delay %f/%f", d.delay, d.clock->value());
-                if (d.delay > 0) {
-                    msleep(64);
-                } else {
-                    //audio packet not cleaned up?
+            if (d.delay > kSyncThreshold) { //Slow down
+                d.delay = waitForClock(pkt.pts, pkt.serial);
+                if (pkt.serial != d.serial) //seeked when waiting
                     continue;
-                }
+            } else if (d.delay < -kSyncThreshold) { //Speed up. drop frame?
+                //continue;
             }
-        } else {
-            d.clock->updateValue(pkt.pts);
         }
         //DO NOT decode and convert if ao is not available or mute!
-        if (dec->decode(pkt.data)) {
+        if (dec->decode(pkt)) {
             QByteArray decoded(dec->data());
+            if (!d.resampler.isPassThrough()) {
+                if (!d.resampler.convert(decoded, &d.resampled))
+                    continue;
+                decoded = d.resampled;
+            }
+            qreal pts = pkt.pts;
+            if (d.seek_target >= 0) {
+                //accurate seek: drop the samples earlier than the target
+                if (pts + (qreal)decoded.size()/(qreal)csf <= d.seek_target)
+                    continue;
+                const int skip = int((d.seek_target - pts)*sample_rate);
+                if (skip > 0) {
+                    decoded = decoded.mid(skip*channels*sizeof(float));
+                    pts += (qreal)skip/(qreal)sample_rate;
+                }
+                d.seek_target = -1;
+            }
+            if (seeked) {
+                seeked = false;
+                finishSeek();
+            }
+            //media time: the decoded duration, the part buffered by the stretcher
+            const qreal duration = (qreal)decoded.size()/(qreal)csf;
+            qreal buffered = 0;
+            d.stretch.setSpeed(speed);
+            if (!d.stretch.isPassThrough()) {
+                d.stretch.process((const float*)decoded.constData(), decoded.size()/(channels*sizeof(float)), &d.stretched);
+                decoded = d.stretched;
+                buffered = d.stretch.buffered();
+            }
             int decodedSize = decoded.size();
             int decodedPos = 0;
-            qreal delay =0;
             while (decodedSize > 0) {
+                //seeked. do not play or update the clock with the old data
+                if (pkt.serial != d.serial)
+                    break;
                 int chunk = qMin(decodedSize, int(max_len*csf));
-                d.clock->updateDelay(delay += (qreal)chunk/(qreal)csf);
                 QByteArray decodedChunk(chunk, 0); //volume == 0 || mute
                 if (ao && ao->isAvailable()) {
                     if (!ao->isMute()) {
@@ -148,10 +193,20 @@ void AudioThread::run()
                 }
                 decodedPos += chunk;
                 decodedSize -= chunk;
+                if (!is_external_clock) {
+                    /*
+                     * the device plays the written samples after its latency. the clock is the pts being played and
+                     * is interpolated until the next update, but not beyond the written samples.
+                     * the output samples not played yet are speed times longer in media time
+                     */
+                    const qreal latency = (ao && ao->isAvailable() ? ao->latency() : 0) * speed;
+                    d.clock->updateDelay(latency);
+                    d.clock->updateValue(pts + duration - buffered - (qreal)decodedSize/(qreal)csf*speed - latency);
+                }
             }
         } else {
             //qWarning("Decode audio failed");
-            qreal dt = pkt.pts - d.last_pts;
+            qreal dt = (pkt.pts - d.last_pts)/speed;
             if (abs(dt) > 0.618 || dt < 0) {
                 dt = 0;
             }
@@ -0,0 +1,329 @@
+/******************************************************************************
+    QtAV:  Media play library based on Qt and FFmpeg
+    Copyright (C) 2012-2013 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+
+
+#include <private/AudioTimeStretch_p.h>
+#include <private/SIMD_p.h>
+#include <QtAV/QtAV_Compat.h>
+#include <math.h>
+#include <string.h>
+extern "C" {
+#include <libavutil/cpu.h>
+}
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+namespace QtAV {
+
+static const qreal kOverlap = 0.015; //seconds. the segments are 2x
+static const qreal kSearch = 0.008; //seconds. longer than the period of the dominant low frequencies
+
+typedef float (*DotFunc)(const float *a, const float *b, int n);
+//out = tail + (head - tail)*fade
+typedef void (*CrossFadeFunc)(const float *tail, const float *head, const float *fade, float *out, int n);
+
+static float dot_C(const float *a, const float *b, int n)
+{
+    float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += a[i]*b[i];
+        s1 += a[i+1]*b[i+1];
+        s2 += a[i+2]*b[i+2];
+        s3 += a[i+3]*b[i+3];
+    }
+    for (; i < n; ++i)
+        s0 += a[i]*b[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+static void crossfade_C(const float *tail, const float *head, const float *fade, float *out, int n)
+{
+    for (int i = 0; i < n; ++i)
+        out[i] = tail[i] + (head[i] - tail[i])*fade[i];
+}
+
+#if QTAV_HAVE_SSE2
+QTAV_TARGET("sse2") static float dot_SSE2(const float *a, const float *b, int n)
+{
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    s0 = _mm_add_ps(s0, s1);
+    s0 = _mm_add_ps(s0, _mm_movehl_ps(s0, s0));
+    s0 = _mm_add_ss(s0, _mm_shuffle_ps(s0, s0, 1));
+    return _mm_cvtss_f32(s0) + dot_C(a + i, b + i, n - i);
+}
+
+QTAV_TARGET("sse2") static void crossfade_SSE2(const float *tail, const float *head, const float *fade, float *out, int n)
+{
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128 t = _mm_loadu_ps(tail + i);
+        const __m128 d = _mm_sub_ps(_mm_loadu_ps(head + i), t);
+        _mm_storeu_ps(out + i, _mm_add_ps(t, _mm_mul_ps(d, _mm_loadu_ps(fade + i))));
+    }
+    crossfade_C(tail + i, head + i, fade + i, out + i, n - i);
+}
+#endif //QTAV_HAVE_SSE2
+
+#if QTAV_HAVE_AVX2
+QTAV_TARGET("avx2") static float dot_AVX2(const float *a, const float *b, int n)
+{
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        s0 = _mm256_add_ps(s0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        s1 = _mm256_add_ps(s1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+    }
+    s0 = _mm256_add_ps(s0, s1);
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(s0), _mm256_extractf128_ps(s0, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    float r = _mm_cvtss_f32(s);
+    //not calling the C function: switching from 256-bit AVX to legacy SSE code is slow
+    for (; i < n; ++i)
+        r += a[i]*b[i];
+    _mm256_zeroupper();
+    return r;
+}
+
+QTAV_TARGET("avx2") static void crossfade_AVX2(const float *tail, const float *head, const float *fade, float *out, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256 t = _mm256_loadu_ps(tail + i);
+        const __m256 d = _mm256_sub_ps(_mm256_loadu_ps(head + i), t);
+        _mm256_storeu_ps(out + i, _mm256_add_ps(t, _mm256_mul_ps(d, _mm256_loadu_ps(fade + i))));
+    }
+    for (; i < n; ++i)
+        out[i] = tail[i] + (head[i] - tail[i])*fade[i];
+    _mm256_zeroupper();
+}
+#endif //QTAV_HAVE_AVX2
+
+struct StretchKernels
+{
+    StretchKernels(AudioTimeStretch::Kernels k)
+        :kernels(AudioTimeStretch::C),dot(dot_C),crossfade(crossfade_C) {
+        if (k == AudioTimeStretch::C)
+            return;
+        const int flags = av_get_cpu_flags();
+        Q_UNUSED(flags);
+#if QTAV_HAVE_SSE2
+        if (flags & AV_CPU_FLAG_SSE2) {
+            kernels = AudioTimeStretch::SSE2;
+            dot = dot_SSE2;
+            crossfade = crossfade_SSE2;
+        }
+#endif
+        if (k == AudioTimeStretch::SSE2)
+            return;
+#if QTAV_HAVE_AVX2 && defined(AV_CPU_FLAG_AVX2)
+        if (flags & AV_CPU_FLAG_AVX2) {
+            kernels = AudioTimeStretch::AVX2;
+            dot = dot_AVX2;
+            crossfade = crossfade_AVX2;
+        }
+#endif
+    }
+    AudioTimeStretch::Kernels kernels; //the kernels actually used
+    DotFunc dot;
+    CrossFadeFunc crossfade;
+};
+
+struct StretchKernelTables
+{
+    StretchKernelTables()
+        :c(AudioTimeStretch::C),sse2(AudioTimeStretch::SSE2),best(AudioTimeStretch::Auto) {}
+    StretchKernels c, sse2, best;
+};
+Q_GLOBAL_STATIC(StretchKernelTables, stretchKernelTables)
+
+static const StretchKernels& stretchKernels(AudioTimeStretch::Kernels k)
+{
+    const StretchKernelTables *t = stretchKernelTables();
+    if (k == AudioTimeStretch::C)
+        return t->c;
+    if (k == AudioTimeStretch::SSE2)
+        return t->sse2;
+    return t->best;
+}
+
+AudioTimeStretch::AudioTimeStretch(Kernels kernels)
+    :kernels_(kernels),rate(0),channels(0),overlap(0),search(0),speed_(1.0),pos(0),tail(-1)
+{
+}
+
+AudioTimeStretch::Kernels AudioTimeStretch::kernels() const
+{
+    return stretchKernels(kernels_).kernels;
+}
+
+void AudioTimeStretch::setFormat(int sampleRate, int channels)
+{
+    if (rate == sampleRate && this->channels == channels)
+        return;
+    rate = sampleRate;
+    this->channels = channels;
+    overlap = qMax(int(sampleRate*kOverlap), 16);
+    search = qMax(int(sampleRate*kSearch), 1);
+    fade.resize(overlap*channels);
+    for (int i = 0; i < overlap; ++i) {
+        const float w = 0.5 - 0.5*cos(M_PI*(i + 0.5)/overlap); //w + the tail's weight = 1
+        for (int c = 0; c < channels; ++c)
+            fade[i*channels + c] = w;
+    }
+    reset();
+}
+
+void AudioTimeStretch::setSpeed(qreal speed)
+{
+    if (speed <= 0) {
+        qWarning("AudioTimeStretch: invalid speed %f", speed);
+        return;
+    }
+    speed_ = speed;
+}
+
+qreal AudioTimeStretch::speed() const
+{
+    return speed_;
+}
+
+bool AudioTimeStretch::isPassThrough() const
+{
+    return speed_ == 1.0 && mono.isEmpty();
+}
+
+qreal AudioTimeStretch::buffered() const
+{
+    if (rate <= 0)
+        return 0;
+    //may be negative: the last hop stands for the input after it
+    return (qreal(mono.size()) - pos)/qreal(rate);
+}
+
+void AudioTimeStretch::reset()
+{
+    input.clear();
+    mono.clear();
+    pos = 0;
+    tail = -1;
+}
+
+void AudioTimeStretch::process(const float *in, int samples, QByteArray *out)
+{
+    if (channels <= 0 || samples < 0) {
+        out->resize(0);
+        return;
+    }
+    const int ch = channels;
+    if (speed_ == 1.0) {
+        //output the natural continuation of the last segment and the input as is. no gap
+        const int from = qMax(tail, 0);
+        const int rest = qMax(mono.size() - from, 0);
+        out->resize((rest + samples)*ch*sizeof(float));
+        float *dst = (float*)out->data();
+        memcpy(dst, input.constData() + from*ch, rest*ch*sizeof(float));
+        memcpy(dst + rest*ch, in, samples*ch*sizeof(float));
+        reset();
+        return;
+    }
+    const int old = mono.size();
+    input.resize((old + samples)*ch);
+    memcpy(input.data() + old*ch, in, samples*ch*sizeof(float));
+    mono.resize(old + samples);
+    const float *s = in;
+    float *m = mono.data() + old;
+    for (int i = 0; i < samples; ++i, s += ch) {
+        float v = 0;
+        for (int c = 0; c < ch; ++c)
+            v += s[c];
+        m[i] = v;
+    }
+    const int frames = mono.size();
+    const qreal hop = qreal(overlap)*speed_;
+    const int max_hops = qMax(int((frames - pos)/hop), 0) + 2;
+    out->resize(max_hops*overlap*ch*sizeof(float));
+    float *dst = (float*)out->data();
+    int written = 0;
+    if (tail < 0) {
+        if (frames < 2*overlap) {
+            out->resize(0);
+            return;
+        }
+        memcpy(dst, input.constData(), overlap*ch*sizeof(float));
+        written = overlap;
+        tail = overlap;
+        pos = hop;
+    }
+    const StretchKernels &k = stretchKernels(kernels_);
+    const float *mo = mono.constData();
+    const float *x = input.constData();
+    const double eps = 1e-9*overlap;
+    forever {
+        const int target = qRound(pos);
+        const int lo = qMax(target - search, 0);
+        const int hi = target + search;
+        if (hi + 2*overlap > frames || written + overlap > max_hops*overlap)
+            break;
+        const float *tpl = mo + tail;
+        double e = k.dot(mo + lo, mo + lo, overlap); //energy of the candidate, updated incrementally
+        double best_score = -1e300;
+        int best = target;
+        for (int j = lo; j <= hi; ++j) {
+            const double score = double(k.dot(tpl, mo + j, overlap))/sqrt(qMax(e, 0.0) + eps);
+            if (score > best_score) {
+                best_score = score;
+                best = j;
+            }
+            e += double(mo[j + overlap])*mo[j + overlap] - double(mo[j])*mo[j];
+        }
+        k.crossfade(x + tail*ch, x + best*ch, fade.constData(), dst + written*ch, overlap*ch);
+        written += overlap;
+        tail = best + overlap;
+        pos += hop;
+    }
+    out->resize(written*ch*sizeof(float));
+    discard();
+}
+
+void AudioTimeStretch::discard()
+{
+    if (tail < 0)
+        return;
+    const int drop = qMin(tail, qRound(pos) - search);
+    if (drop <= 0)
+        return;
+    input.remove(0, drop*channels);
+    mono.remove(0, drop);
+    tail -= drop;
+    pos -= drop;
+}
+
+} //namespace QtAV
@@ -88,6 +88,7 @@ void EventFilter::help()
                        "<p>" + tr("M: mute on/off\n") + "</p>"
                        "<p>" + tr("C: capture video") + "</p>"
                        "<p>" + tr("Up/Down: volume +/-\n") + "</p>"
+                       "<p>" + tr("+/-: speed up/slow down. 0: normal speed\n") + "</p>"
                        "<p>" + tr("->/<-: seek forward/backward\n");
     QMessageBox::about(0, tr("Help"), help);
 }
@@ -166,6 +167,18 @@ bool EventFilter::eventFilter(QObject *watched, QEvent *event)
                 qDebug("vol = %.3f", player->audio()->volume());
             }
             break;
+        case Qt::Key_Plus:
+        case Qt::Key_Equal:
+            player->setSpeed(player->speed() < 1.0 ? player->speed() + 0.25 : player->speed() + 0.5);
+            qDebug("speed = %.2f", player->speed());
+            break;
+        case Qt::Key_Minus:
+            player->setSpeed(player->speed() <= 1.0 ? player->speed() - 0.25 : player->speed() - 0.5);
+            qDebug("speed = %.2f", player->speed());
+            break;
+        case Qt::Key_0:
+            player->setSpeed(1.0);
+            break;
         case Qt::Key_O:
             //TODO: emit a signal so we can use custome dialogs?
             openLocalFile();
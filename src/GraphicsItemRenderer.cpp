@@ -55,9 +55,23 @@ GraphicsItemRenderer::~GraphicsItemRenderer()
 
 bool GraphicsItemRenderer::write()
 {
+    //called in video thread. QGraphicsScene is not thread safe
+    d_func().scheduleRepaint(this);
+	return true;
+}
+
+void GraphicsItemRenderer::customEvent(QEvent *event)
+{
+    if (event->type() != ImageRendererPrivate::repaintEventType()) {
+        GraphicsWidget::customEvent(event);
+        return;
+    }
+    d_func().repaintEventReceived();
+    //no paint if invisible. the latest frame is painted when it is shown
+    if (!scene() || !isVisible())
+        return;
     scene()->update(sceneBoundingRect());
     //update(); //does not cause an immediate paint. my not redraw.
-	return true;
 }
 
 QRectF GraphicsItemRenderer::boundingRect() const
@@ -70,26 +84,22 @@ void GraphicsItemRenderer::paint(QPainter *painter, const QStyleOptionGraphicsIt
 	Q_UNUSED(option);
 	Q_UNUSED(widget);
 	DPTR_D(GraphicsItemRenderer);
-    if (!d.scale_in_renderer) {
-        d.img_mutex.lock();
-    }
+    //the latest complete frame. the video thread writes other buffers, no lock is required
+    QImage &image = d.acquireImage();
     //fill background color only when the displayed frame rect not equas to renderer's
     if (d.out_rect != boundingRect()) {
         painter->fillRect(boundingRect(), QColor(0, 0, 0));
     }
-    if (d.image.isNull()) {
+    if (image.isNull()) {
         //TODO: when setInSize()?
-        d.image = QImage(rendererSize(), QImage::Format_RGB32);
-        d.image.fill(Qt::black); //maemo 4.7.0: QImage.fill(uint)
+        image = QImage(rendererSize(), QImage::Format_RGB32);
+        image.fill(Qt::black); //maemo 4.7.0: QImage.fill(uint)
     }
     //assume that the image data is already scaled to out_size(NOT renderer size!)
-    if (!d.scale_in_renderer || d.image.size() == d.out_rect.size()) {
-        painter->drawImage(d.out_rect.topLeft(), d.image);
+    if (!d.scale_in_renderer || image.size() == d.out_rect.size()) {
+        painter->drawImage(d.out_rect.topLeft(), image);
     } else {
-        painter->drawImage(d.out_rect, d.image);
-    }
-    if (!d.scale_in_renderer) {
-        d.img_mutex.unlock();
+        painter->drawImage(d.out_rect, image);
     }
 }
 //GraphicsWidget will lose focus forever if focus out. Why?
@@ -24,18 +24,31 @@
 #include <private/ImageConverter_p.h>
 #include <QtAV/QtAV_Compat.h>
 #include <QtAV/factory.h>
+#include <QtCore/QThreadPool>
+extern "C" {
+#include <libavutil/imgutils.h>
+}
 
 namespace QtAV {
 
 FACTORY_DEFINE(ImageConverter)
 
+Q_GLOBAL_STATIC(QThreadPool, convertThreadPool)
+
+QThreadPool* imageConvertThreadPool()
+{
+    return convertThreadPool();
+}
+
 extern void RegisterImageConverterFF_Man();
 extern void RegisterImageConverterIPP_Man();
+extern void RegisterImageConverterSIMD_Man();
 
 void ImageConverter_RegisterAll()
 {
     RegisterImageConverterFF_Man();
     RegisterImageConverterIPP_Man();
+    RegisterImageConverterSIMD_Man();
 }
 
 
@@ -63,7 +76,6 @@ void ImageConverter::setInSize(int width, int height)
         return;
     d.w_in = width;
     d.h_in = height;
-    prepareData();
 }
 
 void ImageConverter::setOutSize(int width, int height)
@@ -73,7 +85,6 @@ void ImageConverter::setOutSize(int width, int height)
         return;
     d.w_out = width;
     d.h_out = height;
-    prepareData();
 }
 
 void ImageConverter::setInFormat(int format)
@@ -83,11 +94,7 @@ void ImageConverter::setInFormat(int format)
 
 void ImageConverter::setOutFormat(int format)
 {
-    DPTR_D(ImageConverter);
-    if (d.fmt_out == format)
-        return;
-    d.fmt_out = format;
-    prepareData();
+    d_func().fmt_out = format;
 }
 
 void ImageConverter::setInterlaced(bool interlaced)
@@ -100,9 +107,63 @@ bool ImageConverter::isInterlaced() const
     return d_func().interlaced;
 }
 
+bool ImageConverter::convert(const quint8 *const srcSlice[], const int srcStride[])
+{
+    DPTR_D(ImageConverter);
+    //Check out dimension. equals to in dimension if not setted.
+    if (d.w_out == 0 || d.h_out == 0) {
+        if (d.w_in == 0 || d.h_in == 0)
+            return false;
+        setOutSize(d.w_in, d.h_in);
+    }
+    //the last output may be still used by the consumer, e.g. queued in VideoThread. do not overwrite it
+    if (!d.data_out.isDetached() || d.data_out.size() != avpicture_get_size((PixelFormat)d.fmt_out, d.w_out, d.h_out)) {
+        if (!prepareData())
+            return false;
+    }
+    return convert(srcSlice, srcStride, d.picture.data, d.picture.linesize);
+}
+
+int ImageConverter::outLineSize(int plane, int align) const
+{
+    DPTR_D(const ImageConverter);
+    int linesize[4];
+    if (av_image_fill_linesizes(linesize, (PixelFormat)d.fmt_out, d.w_out) < 0 || plane < 0 || plane > 3)
+        return 0;
+    if (align <= 1)
+        return linesize[plane];
+    return (linesize[plane] + align - 1)/align*align;
+}
+
+void ImageConverter::setThreads(int threads)
+{
+    d_func().threads = qMax(threads, 0);
+}
+
+int ImageConverter::threads() const
+{
+    return d_func().threads;
+}
+
 bool ImageConverter::prepareData()
 {
-    return false;
+    DPTR_D(ImageConverter);
+    int bytes = avpicture_get_size((PixelFormat)d.fmt_out, d.w_out, d.h_out);
+    //shared with the consumer. allocate a new buffer instead of detaching(copying) it
+    if (!d.data_out.isDetached())
+        d.data_out = QByteArray();
+    //if (d.data_out.size() < bytes) {
+        d.data_out.resize(bytes);
+    //}
+    //picture的数据按PIX_FMT格式自动"关联"到 data
+    avpicture_fill(
+            &d.picture,
+            reinterpret_cast<uint8_t*>(d.data_out.data()),
+            (PixelFormat)d.fmt_out,
+            d.w_out,
+            d.h_out
+            );
+    return true;
 }
 
 } //namespace QtAV
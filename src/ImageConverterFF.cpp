@@ -22,19 +22,50 @@
 #include <QtAV/ImageConverter.h>
 #include <private/ImageConverter_p.h>
 #include <QtAV/QtAV_Compat.h>
+#include <QtCore/QRunnable>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include <QtCore/QVector>
 #include "prepost.h"
 
 namespace QtAV {
 
+static const int kMinBandHeight = 64;
+/*
+ * band boundaries are aligned to it so that the chroma lines and the dither pattern(depends on line & 7)
+ * are the same as converting the whole picture
+ */
+static const int kBandAlign = 16;
+
+class ConvertBandTask : public QRunnable
+{
+public:
+    ConvertBandTask():sws_ctx(0),height(0),result(0),done(0) {
+        setAutoDelete(false);
+    }
+    virtual void run() {
+        result = sws_scale(sws_ctx, src, src_stride, 0, height, dst, dst_stride);
+        done->release();
+    }
+
+    SwsContext *sws_ctx;
+    const quint8 *src[4];
+    int src_stride[4];
+    quint8 *dst[4];
+    int dst_stride[4];
+    int height;
+    int result;
+    QSemaphore *done;
+};
+
 class ImageConverterFFPrivate;
 class ImageConverterFF : public ImageConverter //Q_EXPORT is not needed
 {
     DPTR_DECLARE_PRIVATE(ImageConverterFF)
 public:
     ImageConverterFF();
-    virtual bool convert(const quint8 *const srcSlice[], const int srcStride[]);
-protected:
-    virtual bool prepareData(); //Allocate memory for out data
+    virtual bool convert(const quint8 *const srcSlice[], const int srcStride[], quint8 *const dst[], const int dstStride[]);
 };
 
 
@@ -55,26 +86,106 @@ public:
             sws_freeContext(sws_ctx);
             sws_ctx = 0;
         }
+        for (int i = 0; i < band_ctx.size(); ++i) {
+            if (band_ctx[i])
+                sws_freeContext(band_ctx[i]);
+        }
+        band_ctx.clear();
+        qDeleteAll(tasks);
+        tasks.clear();
+    }
+    /*
+     * The bands are converted separately only if the picture is not scaled. A scaler filters the neighbour
+     * lines, so the result near band boundaries would be different from converting the whole picture.
+     * Formats with a palette are not split either.
+     */
+    int bandCount() const {
+        if (w_in != w_out || h_in != h_out)
+            return 1;
+        const AVPixFmtDescriptor *desc_in = av_pix_fmt_desc_get((PixelFormat)fmt_in);
+        const AVPixFmtDescriptor *desc_out = av_pix_fmt_desc_get((PixelFormat)fmt_out);
+        if ((desc_in->flags & PIX_FMT_PAL) || (desc_out->flags & PIX_FMT_PAL))
+            return 1;
+        int n = threads > 0 ? threads : QThread::idealThreadCount();
+        return qMax(qMin(n, h_out/kMinBandHeight), 1);
     }
+    //the line offset of plane in a picture of format fmt at line y
+    static int planeOffset(int fmt, int plane, int y) {
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((PixelFormat)fmt);
+        int planes = 0;
+        bool chroma = false;
+        for (int i = 0; i < desc->nb_components; ++i) {
+            planes = qMax(planes, desc->comp[i].plane + 1);
+            if (desc->comp[i].plane == plane)
+                chroma = i == 1 || i == 2;
+        }
+        if (plane >= planes) //palette
+            return -1;
+        return chroma ? y >> desc->log2_chroma_h : y;
+    }
+    bool convertBands(int bands, const quint8 *const srcSlice[], const int srcStride[], quint8 *const dst[], const int dstStride[]);
 
     SwsContext *sws_ctx;
-    AVPicture picture;
+    QVector<SwsContext*> band_ctx;
+    QVector<ConvertBandTask*> tasks;
 };
 
+bool ImageConverterFFPrivate::convertBands(int bands, const quint8 *const srcSlice[], const int srcStride[], quint8 *const dst[], const int dstStride[])
+{
+    int band_h = (h_out + bands - 1)/bands;
+    band_h = (band_h + kBandAlign - 1) & ~(kBandAlign - 1);
+    bands = (h_out + band_h - 1)/band_h;
+    if (band_ctx.size() < bands)
+        band_ctx.resize(bands); //new elements are 0
+    while (tasks.size() < bands)
+        tasks.append(new ConvertBandTask());
+    QSemaphore done;
+    for (int i = 0; i < bands; ++i) {
+        const int y = i*band_h;
+        const int h = qMin(band_h, h_out - y);
+        band_ctx[i] = sws_getCachedContext(band_ctx[i]
+                , w_in, h, (PixelFormat)fmt_in
+                , w_out, h, (PixelFormat)fmt_out
+                , SWS_POINT, NULL, NULL, NULL);
+        if (!band_ctx[i])
+            return false;
+        ConvertBandTask &task = *tasks[i];
+        task.sws_ctx = band_ctx[i];
+        task.height = h;
+        task.done = &done;
+        for (int p = 0; p < 4; ++p) {
+            const int in_line = planeOffset(fmt_in, p, y);
+            task.src[p] = srcSlice[p] && in_line >= 0 ? srcSlice[p] + in_line*srcStride[p] : srcSlice[p];
+            task.src_stride[p] = srcStride[p];
+            const int out_line = planeOffset(fmt_out, p, y);
+            task.dst[p] = dst[p] && out_line >= 0 ? dst[p] + out_line*dstStride[p] : dst[p];
+            task.dst_stride[p] = dstStride[p];
+        }
+    }
+    for (int i = 1; i < bands; ++i)
+        imageConvertThreadPool()->start(tasks[i]);
+    tasks[0]->run(); //in current thread
+    done.acquire(bands);
+    bool ok = true;
+    for (int i = 0; i < bands; ++i) {
+        if (tasks[i]->result != tasks[i]->height) {
+            qDebug("convert band %d failed: %d, %d", i, tasks[i]->result, tasks[i]->height);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
 ImageConverterFF::ImageConverterFF()
     :ImageConverter(*new ImageConverterFFPrivate())
 {
 }
 
-bool ImageConverterFF::convert(const quint8 *const srcSlice[], const int srcStride[])
+bool ImageConverterFF::convert(const quint8 *const srcSlice[], const int srcStride[], quint8 *const dst[], const int dstStride[])
 {
     DPTR_D(ImageConverterFF);
-    //Check out dimension. equals to in dimension if not setted. TODO: move to another common func
-    if (d.w_out == 0 || d.h_out == 0) {
-        if (d.w_in == 0 || d.h_in == 0)
-            return false;
-        setOutSize(d.w_in, d.h_in);
-    }
+    if (d.w_out == 0 || d.h_out == 0)
+        return false;
 //TODO: move those code to prepare()
     d.sws_ctx = sws_getCachedContext(d.sws_ctx
             , d.w_in, d.h_in, (PixelFormat)d.fmt_in
@@ -124,33 +235,25 @@ bool ImageConverterFF::convert(const quint8 *const srcSlice[], const int srcStri
         pic_out.linesize[0] = w_out * 4;
     }
 #endif //PREPAREDATA_NO_PICTURE
-    int result_h = sws_scale(d.sws_ctx, srcSlice, srcStride, 0, d.h_in, d.picture.data, d.picture.linesize);
-    if (result_h != d.h_out) {
-        qDebug("convert failed: %d, %d", result_h, d.h_out);
-        return false;
+    const int bands = d.bandCount();
+    if (bands > 1) {
+        if (!d.convertBands(bands, srcSlice, srcStride, dst, dstStride))
+            return false;
+    } else {
+        int result_h = sws_scale(d.sws_ctx, srcSlice, srcStride, 0, d.h_in, dst, dstStride);
+        if (result_h != d.h_out) {
+            qDebug("convert failed: %d, %d", result_h, d.h_out);
+            return false;
+        }
     }
     if (isInterlaced()) {
-        avpicture_deinterlace(&d.picture, &d.picture, (PixelFormat)d.fmt_out, d.w_out, d.h_out);
+        AVPicture picture;
+        for (int i = 0; i < 4; ++i) {
+            picture.data[i] = dst[i];
+            picture.linesize[i] = dstStride[i];
+        }
+        avpicture_deinterlace(&picture, &picture, (PixelFormat)d.fmt_out, d.w_out, d.h_out);
     }
-    Q_UNUSED(result_h);
-    return true;
-}
-
-bool ImageConverterFF::prepareData()
-{
-    DPTR_D(ImageConverterFF);
-    int bytes = avpicture_get_size((PixelFormat)d.fmt_out, d.w_out, d.h_out);
-    //if (d.data_out.size() < bytes) {
-        d.data_out.resize(bytes);
-    //}
-    //picture的数据按PIX_FMT格式自动"关联"到 data
-    avpicture_fill(
-            &d.picture,
-            reinterpret_cast<uint8_t*>(d.data_out.data()),
-            (PixelFormat)d.fmt_out,
-            d.w_out,
-            d.h_out
-            );
     return true;
 }
 
@@ -0,0 +1,661 @@
+/******************************************************************************
+    QtAV:  Media play library based on Qt and FFmpeg
+    Copyright (C) 2012-2013 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+
+#include <QtAV/ImageConverter.h>
+#include <QtAV/ImageConverterTypes.h>
+#include <private/ImageConverter_p.h>
+#include <private/ImageConverterSIMD_p.h>
+#include <private/SIMD_p.h>
+#include <QtAV/QtAV_Compat.h>
+#include <QtCore/QRunnable>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include <QtCore/QVector>
+#include "prepost.h"
+extern "C" {
+#include <libavutil/cpu.h>
+}
+
+/*
+ * YUV420P/NV12/YUV422P => RGB32/BGR32 with bilinear scaling. BT.601 limited range:
+ *   R = (298*(Y-16) + 409*(V-128) + 128) >> 8
+ *   G = (298*(Y-16) - 100*(U-128) - 208*(V-128) + 128) >> 8
+ *   B = (298*(Y-16) + 516*(U-128) + 128) >> 8
+ * The SIMD kernels use 32 bit products(pmaddwd), so the result is exactly the same as the C code.
+ * A picture is converted line by line. If scaled, the source lines are blended vertically, then the output
+ * line is sampled horizontally from the blended line. The kernels are selected at runtime.
+ * Other formats are converted by ImageConverterFF.
+ */
+
+namespace QtAV {
+
+/*
+ * y: a line of luma. u, v: a line of chroma, horizontally subsampled by 2.
+ * For NV12 u is the interleaved chroma and v is not used.
+ * dst: width pixels. swap_rb: BGR32
+ */
+typedef void (*YUVLineFunc)(const quint8 *y, const quint8 *u, const quint8 *v, quint8 *dst, int width, bool swap_rb);
+//dst[i] = (a[i]*(256-f) + b[i]*f + 128) >> 8
+typedef void (*BlendLineFunc)(const quint8 *a, const quint8 *b, int f, quint8 *dst, int width);
+
+static inline quint8 clip8(int x)
+{
+    return x < 0 ? 0 : (x > 255 ? 255 : x);
+}
+
+static inline void yuv2rgb(int y, int u, int v, quint8 *dst, bool swap_rb)
+{
+    const int c = 298*(y - 16) + 128;
+    u -= 128;
+    v -= 128;
+    const quint8 r = clip8((c + 409*v) >> 8);
+    const quint8 g = clip8((c - 100*u - 208*v) >> 8);
+    const quint8 b = clip8((c + 516*u) >> 8);
+    //PIX_FMT_RGB32 is 0xAARRGGBB in native endian
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    dst[0] = swap_rb ? r : b;
+    dst[1] = g;
+    dst[2] = swap_rb ? b : r;
+    dst[3] = 0xff;
+#else
+    dst[0] = 0xff;
+    dst[1] = swap_rb ? b : r;
+    dst[2] = g;
+    dst[3] = swap_rb ? r : b;
+#endif
+}
+
+static void yuv2rgb_line_C(const quint8 *y, const quint8 *u, const quint8 *v, quint8 *dst, int width, bool swap_rb)
+{
+    for (int x = 0; x < width; ++x)
+        yuv2rgb(y[x], u[x>>1], v[x>>1], dst + 4*x, swap_rb);
+}
+
+static void nv12torgb_line_C(const quint8 *y, const quint8 *uv, const quint8 *, quint8 *dst, int width, bool swap_rb)
+{
+    for (int x = 0; x < width; ++x)
+        yuv2rgb(y[x], uv[x&~1], uv[(x&~1)+1], dst + 4*x, swap_rb);
+}
+
+static void blend_line_C(const quint8 *a, const quint8 *b, int f, quint8 *dst, int width)
+{
+    const int f0 = 256 - f;
+    for (int x = 0; x < width; ++x)
+        dst[x] = (a[x]*f0 + b[x]*f + 128) >> 8;
+}
+
+#if QTAV_HAVE_SSE2
+/*
+ * y, u, v: 8 values in 16 bit, already subtracted by 16, 128, 128. writes 8 pixels.
+ * swap_rb is the same for a whole picture, the branch is predicted
+ */
+QTAV_TARGET("sse2") static inline void yuv2rgb_8_SSE2(__m128i y, __m128i u, __m128i v, quint8 *dst, bool swap_rb)
+{
+    const __m128i kY = _mm_set1_epi32(128 << 16 | 298); //y*298 + 1*128
+    const __m128i kR = _mm_set1_epi32(409 << 16 | 0);
+    const __m128i kG = _mm_set1_epi32((-208 & 0xffff) << 16 | (-100 & 0xffff));
+    const __m128i kB = _mm_set1_epi32(0 << 16 | 516);
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i y_lo = _mm_madd_epi16(_mm_unpacklo_epi16(y, one), kY);
+    const __m128i y_hi = _mm_madd_epi16(_mm_unpackhi_epi16(y, one), kY);
+    const __m128i uv_lo = _mm_unpacklo_epi16(u, v);
+    const __m128i uv_hi = _mm_unpackhi_epi16(u, v);
+#define QTAV_YUV2RGB_COMPONENT(k) \
+    _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(y_lo, _mm_madd_epi16(uv_lo, k)), 8) \
+                  , _mm_srai_epi32(_mm_add_epi32(y_hi, _mm_madd_epi16(uv_hi, k)), 8))
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max = _mm_set1_epi16(255);
+    __m128i r = _mm_min_epi16(_mm_max_epi16(QTAV_YUV2RGB_COMPONENT(kR), zero), max);
+    const __m128i g = _mm_min_epi16(_mm_max_epi16(QTAV_YUV2RGB_COMPONENT(kG), zero), max);
+    __m128i b = _mm_min_epi16(_mm_max_epi16(QTAV_YUV2RGB_COMPONENT(kB), zero), max);
+#undef QTAV_YUV2RGB_COMPONENT
+    if (swap_rb) {
+        const __m128i t = r;
+        r = b;
+        b = t;
+    }
+    //little endian: b g r a
+    const __m128i bg = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+    const __m128i ra = _mm_or_si128(r, _mm_set1_epi16((short)0xff00));
+    _mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi16(bg, ra));
+    _mm_storeu_si128((__m128i*)(dst + 16), _mm_unpackhi_epi16(bg, ra));
+}
+
+QTAV_TARGET("sse2") static void yuv2rgb_line_SSE2(const quint8 *y, const quint8 *u, const quint8 *v, quint8 *dst, int width, bool swap_rb)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i k16 = _mm_set1_epi16(16);
+    const __m128i k128 = _mm_set1_epi16(128);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i y8 = _mm_loadu_si128((const __m128i*)(y + x));
+        __m128i u8 = _mm_loadl_epi64((const __m128i*)(u + x/2));
+        __m128i v8 = _mm_loadl_epi64((const __m128i*)(v + x/2));
+        u8 = _mm_unpacklo_epi8(u8, u8);
+        v8 = _mm_unpacklo_epi8(v8, v8);
+        yuv2rgb_8_SSE2(_mm_sub_epi16(_mm_unpacklo_epi8(y8, zero), k16)
+                       , _mm_sub_epi16(_mm_unpacklo_epi8(u8, zero), k128)
+                       , _mm_sub_epi16(_mm_unpacklo_epi8(v8, zero), k128)
+                       , dst + 4*x, swap_rb);
+        yuv2rgb_8_SSE2(_mm_sub_epi16(_mm_unpackhi_epi8(y8, zero), k16)
+                       , _mm_sub_epi16(_mm_unpackhi_epi8(u8, zero), k128)
+                       , _mm_sub_epi16(_mm_unpackhi_epi8(v8, zero), k128)
+                       , dst + 4*x + 32, swap_rb);
+    }
+    yuv2rgb_line_C(y + x, u + x/2, v + x/2, dst + 4*x, width - x, swap_rb);
+}
+
+QTAV_TARGET("sse2") static void nv12torgb_line_SSE2(const quint8 *y, const quint8 *uv, const quint8 *, quint8 *dst, int width, bool swap_rb)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i k16 = _mm_set1_epi16(16);
+    const __m128i k128 = _mm_set1_epi16(128);
+    const __m128i mask = _mm_set1_epi16(0xff);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i y8 = _mm_loadu_si128((const __m128i*)(y + x));
+        const __m128i uv8 = _mm_loadu_si128((const __m128i*)(uv + x));
+        const __m128i u = _mm_sub_epi16(_mm_and_si128(uv8, mask), k128);
+        const __m128i v = _mm_sub_epi16(_mm_srli_epi16(uv8, 8), k128);
+        yuv2rgb_8_SSE2(_mm_sub_epi16(_mm_unpacklo_epi8(y8, zero), k16)
+                       , _mm_unpacklo_epi16(u, u), _mm_unpacklo_epi16(v, v)
+                       , dst + 4*x, swap_rb);
+        yuv2rgb_8_SSE2(_mm_sub_epi16(_mm_unpackhi_epi8(y8, zero), k16)
+                       , _mm_unpackhi_epi16(u, u), _mm_unpackhi_epi16(v, v)
+                       , dst + 4*x + 32, swap_rb);
+    }
+    nv12torgb_line_C(y + x, uv + x, 0, dst + 4*x, width - x, swap_rb);
+}
+
+QTAV_TARGET("sse2") static void blend_line_SSE2(const quint8 *a, const quint8 *b, int f, quint8 *dst, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i f0 = _mm_set1_epi16(256 - f);
+    const __m128i f1 = _mm_set1_epi16(f);
+    const __m128i k128 = _mm_set1_epi16(128);
+    int x = 0;
+    //a*f0 + b*f1 <= 255*256, fits in unsigned 16 bit
+    for (; x + 16 <= width; x += 16) {
+        const __m128i a8 = _mm_loadu_si128((const __m128i*)(a + x));
+        const __m128i b8 = _mm_loadu_si128((const __m128i*)(b + x));
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a8, zero), f0)
+                                   , _mm_mullo_epi16(_mm_unpacklo_epi8(b8, zero), f1));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a8, zero), f0)
+                                   , _mm_mullo_epi16(_mm_unpackhi_epi8(b8, zero), f1));
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, k128), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, k128), 8);
+        _mm_storeu_si128((__m128i*)(dst + x), _mm_packus_epi16(lo, hi));
+    }
+    blend_line_C(a + x, b + x, f, dst + x, width - x);
+}
+#endif //QTAV_HAVE_SSE2
+
+#if QTAV_HAVE_SSSE3
+//pshufb splits and upsamples the interleaved chroma in 1 instruction
+QTAV_TARGET("ssse3") static void nv12torgb_line_SSSE3(const quint8 *y, const quint8 *uv, const quint8 *, quint8 *dst, int width, bool swap_rb)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i k16 = _mm_set1_epi16(16);
+    const __m128i k128 = _mm_set1_epi16(128);
+    const __m128i shuf_u = _mm_setr_epi8(0, 0, 2, 2, 4, 4, 6, 6, 8, 8, 10, 10, 12, 12, 14, 14);
+    const __m128i shuf_v = _mm_setr_epi8(1, 1, 3, 3, 5, 5, 7, 7, 9, 9, 11, 11, 13, 13, 15, 15);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i y8 = _mm_loadu_si128((const __m128i*)(y + x));
+        const __m128i uv8 = _mm_loadu_si128((const __m128i*)(uv + x));
+        const __m128i u8 = _mm_shuffle_epi8(uv8, shuf_u);
+        const __m128i v8 = _mm_shuffle_epi8(uv8, shuf_v);
+        yuv2rgb_8_SSE2(_mm_sub_epi16(_mm_unpacklo_epi8(y8, zero), k16)
+                       , _mm_sub_epi16(_mm_unpacklo_epi8(u8, zero), k128)
+                       , _mm_sub_epi16(_mm_unpacklo_epi8(v8, zero), k128)
+                       , dst + 4*x, swap_rb);
+        yuv2rgb_8_SSE2(_mm_sub_epi16(_mm_unpackhi_epi8(y8, zero), k16)
+                       , _mm_sub_epi16(_mm_unpackhi_epi8(u8, zero), k128)
+                       , _mm_sub_epi16(_mm_unpackhi_epi8(v8, zero), k128)
+                       , dst + 4*x + 32, swap_rb);
+    }
+    nv12torgb_line_C(y + x, uv + x, 0, dst + 4*x, width - x, swap_rb);
+}
+#endif //QTAV_HAVE_SSSE3
+
+#if QTAV_HAVE_AVX2
+/*
+ * y, u, v: 16 values in 16 bit, already subtracted by 16, 128, 128. writes 16 pixels.
+ * unpack and pack are in 128 bit lanes, packs_epi32 restores the order changed by unpack
+ */
+QTAV_TARGET("avx2") static inline void yuv2rgb_16_AVX2(__m256i y, __m256i u, __m256i v, quint8 *dst, bool swap_rb)
+{
+    const __m256i kY = _mm256_set1_epi32(128 << 16 | 298);
+    const __m256i kR = _mm256_set1_epi32(409 << 16 | 0);
+    const __m256i kG = _mm256_set1_epi32((-208 & 0xffff) << 16 | (-100 & 0xffff));
+    const __m256i kB = _mm256_set1_epi32(0 << 16 | 516);
+    const __m256i one = _mm256_set1_epi16(1);
+    const __m256i y_lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(y, one), kY);
+    const __m256i y_hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(y, one), kY);
+    const __m256i uv_lo = _mm256_unpacklo_epi16(u, v);
+    const __m256i uv_hi = _mm256_unpackhi_epi16(u, v);
+#define QTAV_YUV2RGB_COMPONENT(k) \
+    _mm256_packs_epi32(_mm256_srai_epi32(_mm256_add_epi32(y_lo, _mm256_madd_epi16(uv_lo, k)), 8) \
+                     , _mm256_srai_epi32(_mm256_add_epi32(y_hi, _mm256_madd_epi16(uv_hi, k)), 8))
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i max = _mm256_set1_epi16(255);
+    __m256i r = _mm256_min_epi16(_mm256_max_epi16(QTAV_YUV2RGB_COMPONENT(kR), zero), max);
+    const __m256i g = _mm256_min_epi16(_mm256_max_epi16(QTAV_YUV2RGB_COMPONENT(kG), zero), max);
+    __m256i b = _mm256_min_epi16(_mm256_max_epi16(QTAV_YUV2RGB_COMPONENT(kB), zero), max);
+#undef QTAV_YUV2RGB_COMPONENT
+    if (swap_rb) {
+        const __m256i t = r;
+        r = b;
+        b = t;
+    }
+    const __m256i bg = _mm256_or_si256(b, _mm256_slli_epi16(g, 8));
+    const __m256i ra = _mm256_or_si256(r, _mm256_set1_epi16((short)0xff00));
+    //lo: pixels 0-3, 8-11. hi: 4-7, 12-15
+    const __m256i lo = _mm256_unpacklo_epi16(bg, ra);
+    const __m256i hi = _mm256_unpackhi_epi16(bg, ra);
+    _mm256_storeu_si256((__m256i*)dst, _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256((__m256i*)(dst + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+QTAV_TARGET("avx2") static void yuv2rgb_line_AVX2(const quint8 *y, const quint8 *u, const quint8 *v, quint8 *dst, int width, bool swap_rb)
+{
+    const __m256i k16 = _mm256_set1_epi16(16);
+    const __m256i k128 = _mm256_set1_epi16(128);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i y8 = _mm_loadu_si128((const __m128i*)(y + x));
+        __m128i u8 = _mm_loadl_epi64((const __m128i*)(u + x/2));
+        __m128i v8 = _mm_loadl_epi64((const __m128i*)(v + x/2));
+        u8 = _mm_unpacklo_epi8(u8, u8);
+        v8 = _mm_unpacklo_epi8(v8, v8);
+        yuv2rgb_16_AVX2(_mm256_sub_epi16(_mm256_cvtepu8_epi16(y8), k16)
+                        , _mm256_sub_epi16(_mm256_cvtepu8_epi16(u8), k128)
+                        , _mm256_sub_epi16(_mm256_cvtepu8_epi16(v8), k128)
+                        , dst + 4*x, swap_rb);
+    }
+    yuv2rgb_line_C(y + x, u + x/2, v + x/2, dst + 4*x, width - x, swap_rb);
+}
+
+QTAV_TARGET("avx2") static void nv12torgb_line_AVX2(const quint8 *y, const quint8 *uv, const quint8 *, quint8 *dst, int width, bool swap_rb)
+{
+    const __m256i k16 = _mm256_set1_epi16(16);
+    const __m256i k128 = _mm256_set1_epi16(128);
+    const __m128i shuf_u = _mm_setr_epi8(0, 0, 2, 2, 4, 4, 6, 6, 8, 8, 10, 10, 12, 12, 14, 14);
+    const __m128i shuf_v = _mm_setr_epi8(1, 1, 3, 3, 5, 5, 7, 7, 9, 9, 11, 11, 13, 13, 15, 15);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i y8 = _mm_loadu_si128((const __m128i*)(y + x));
+        const __m128i uv8 = _mm_loadu_si128((const __m128i*)(uv + x));
+        yuv2rgb_16_AVX2(_mm256_sub_epi16(_mm256_cvtepu8_epi16(y8), k16)
+                        , _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_shuffle_epi8(uv8, shuf_u)), k128)
+                        , _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_shuffle_epi8(uv8, shuf_v)), k128)
+                        , dst + 4*x, swap_rb);
+    }
+    nv12torgb_line_C(y + x, uv + x, 0, dst + 4*x, width - x, swap_rb);
+}
+
+QTAV_TARGET("avx2") static void blend_line_AVX2(const quint8 *a, const quint8 *b, int f, quint8 *dst, int width)
+{
+    const __m256i f0 = _mm256_set1_epi16(256 - f);
+    const __m256i f1 = _mm256_set1_epi16(f);
+    const __m256i k128 = _mm256_set1_epi16(128);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m256i a16 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(a + x)));
+        const __m256i b16 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(b + x)));
+        __m256i d = _mm256_add_epi16(_mm256_mullo_epi16(a16, f0), _mm256_mullo_epi16(b16, f1));
+        d = _mm256_srli_epi16(_mm256_add_epi16(d, k128), 8);
+        //packus is in lanes. 0xd8: 64 bit elements 0, 2, 1, 3
+        d = _mm256_permute4x64_epi64(_mm256_packus_epi16(d, d), 0xd8);
+        _mm_storeu_si128((__m128i*)(dst + x), _mm256_castsi256_si128(d));
+    }
+    blend_line_C(a + x, b + x, f, dst + x, width - x);
+}
+#endif //QTAV_HAVE_AVX2
+
+struct SIMDKernels
+{
+    SIMDKernels(ImageConverterSIMD::Kernels k)
+        :kernels(ImageConverterSIMD::C),yuv2rgb(yuv2rgb_line_C),nv12torgb(nv12torgb_line_C),blend(blend_line_C) {
+        if (k == ImageConverterSIMD::C)
+            return;
+        const int flags = av_get_cpu_flags();
+        Q_UNUSED(flags);
+#if QTAV_HAVE_SSE2
+        if (flags & AV_CPU_FLAG_SSE2) {
+            kernels = ImageConverterSIMD::SSE2;
+            yuv2rgb = yuv2rgb_line_SSE2;
+            nv12torgb = nv12torgb_line_SSE2;
+            blend = blend_line_SSE2;
+        }
+#endif
+        if (k == ImageConverterSIMD::SSE2)
+            return;
+#if QTAV_HAVE_SSSE3
+        if (flags & AV_CPU_FLAG_SSSE3) {
+            kernels = ImageConverterSIMD::SSSE3;
+            nv12torgb = nv12torgb_line_SSSE3;
+        }
+#endif
+        if (k == ImageConverterSIMD::SSSE3)
+            return;
+#if QTAV_HAVE_AVX2 && defined(AV_CPU_FLAG_AVX2)
+        if (flags & AV_CPU_FLAG_AVX2) {
+            kernels = ImageConverterSIMD::AVX2;
+            yuv2rgb = yuv2rgb_line_AVX2;
+            nv12torgb = nv12torgb_line_AVX2;
+            blend = blend_line_AVX2;
+        }
+#endif
+    }
+    ImageConverterSIMD::Kernels kernels; //the kernels actually used
+    YUVLineFunc yuv2rgb;
+    YUVLineFunc nv12torgb;
+    BlendLineFunc blend;
+};
+
+struct SIMDKernelTables
+{
+    SIMDKernelTables()
+        :c(ImageConverterSIMD::C),sse2(ImageConverterSIMD::SSE2),ssse3(ImageConverterSIMD::SSSE3)
+        ,best(ImageConverterSIMD::Auto) {}
+    SIMDKernels c, sse2, ssse3, best;
+};
+Q_GLOBAL_STATIC(SIMDKernelTables, simdKernelTables)
+
+static const SIMDKernels& simdKernels(ImageConverterSIMD::Kernels k)
+{
+    const SIMDKernelTables *t = simdKernelTables();
+    switch (k) {
+    case ImageConverterSIMD::C: return t->c;
+    case ImageConverterSIMD::SSE2: return t->sse2;
+    case ImageConverterSIMD::SSSE3: return t->ssse3;
+    default: return t->best;
+    }
+}
+
+//bilinear taps. sample i = (src[i0[i]]*(256-f[i]) + src[i1[i]]*f[i]) >> 8
+struct ScaleTaps
+{
+    //the position of sample i in source is i*scale + offset
+    void compute(int n, double scale, double offset, int src_size) {
+        i0.resize(n);
+        i1.resize(n);
+        f.resize(n);
+        for (int i = 0; i < n; ++i) {
+            double pos = qBound(0.0, i*scale + offset, double(src_size - 1));
+            int p = int(pos);
+            i0[i] = p;
+            i1[i] = qMin(p + 1, src_size - 1);
+            f[i] = qMin(int((pos - p)*256.0 + 0.5), 256);
+        }
+    }
+    QVector<int> i0, i1, f;
+};
+
+//step: 2 for interleaved chroma
+static void scale_line(const quint8 *src, int step, const ScaleTaps& taps, quint8 *dst)
+{
+    const int *i0 = taps.i0.constData();
+    const int *i1 = taps.i1.constData();
+    const int *f = taps.f.constData();
+    for (int i = 0; i < taps.f.size(); ++i)
+        dst[i] = (src[i0[i]*step]*(256 - f[i]) + src[i1[i]*step]*f[i] + 128) >> 8;
+}
+
+ImageConverterId ImageConverterId_SIMD = 2;
+FACTORY_REGISTER_ID_AUTO(ImageConverter, SIMD, "SIMD")
+
+void RegisterImageConverterSIMD_Man()
+{
+    FACTORY_REGISTER_ID_MAN(ImageConverter, SIMD, "SIMD")
+}
+
+static const int kMinBandHeight = 64; //lines converted by a thread at least
+
+//the lines used by scaleLines(). each band has its own
+struct ScaleBuffers
+{
+    void reserve(int blend, int luma, int chroma) {
+        if (blended.size() < blend)
+            blended.resize(blend);
+        if (line_y.size() < luma)
+            line_y.resize(luma);
+        if (line_u.size() < chroma)
+            line_u.resize(chroma);
+        if (line_v.size() < chroma)
+            line_v.resize(chroma);
+    }
+    QByteArray blended, line_y, line_u, line_v;
+};
+
+class SIMDBandTask;
+class ImageConverterSIMDPrivate : public ImageConverterPrivate
+{
+public:
+    ImageConverterSIMDPrivate():kernels(ImageConverterSIMD::Auto),ff(0),taps_fmt(-1),taps_w_in(0),taps_h_in(0),taps_w_out(0),taps_h_out(0){}
+    ~ImageConverterSIMDPrivate();
+    bool isSupported() const {
+        return (fmt_in == PIX_FMT_YUV420P || fmt_in == PIX_FMT_NV12 || fmt_in == PIX_FMT_YUV422P)
+                && (fmt_out == PIX_FMT_RGB32 || fmt_out == PIX_FMT_BGR32);
+    }
+    //every output line is computed from the source independently, so any band split gives the same result
+    int bandCount() const {
+        const int n = threads > 0 ? threads : QThread::idealThreadCount();
+        return qMax(qMin(n, h_out/kMinBandHeight), 1);
+    }
+    void computeTaps();
+    //convert or scale the output lines [y0, y1)
+    void convertLines(const quint8 *const src[], const int stride[], quint8 *dst, int dstStride, int y0, int y1);
+    void scaleLines(const quint8 *const src[], const int stride[], quint8 *dst, int dstStride, int y0, int y1, ScaleBuffers *buf);
+    void convertBands(int bands, bool scale, const quint8 *const src[], const int stride[], quint8 *dst, int dstStride);
+    bool convertFF(const quint8 *const srcSlice[], const int srcStride[], quint8 *const dst[], const int dstStride[]);
+
+    ImageConverterSIMD::Kernels kernels; //requested
+    ImageConverter *ff; //for other formats and interlaced pictures
+    int taps_fmt; //the input format taps are computed for
+    int taps_w_in, taps_h_in, taps_w_out, taps_h_out; //the sizes taps are computed for
+    ScaleTaps x_luma, x_chroma, y_luma, y_chroma;
+    ScaleBuffers buffers; //for the band converted in the calling thread
+    QVector<SIMDBandTask*> tasks;
+};
+
+class SIMDBandTask : public QRunnable
+{
+public:
+    SIMDBandTask():conv(0),src(0),stride(0),dst(0),dst_stride(0),y0(0),y1(0),scale(false),done(0) {
+        setAutoDelete(false);
+    }
+    virtual void run() {
+        if (scale)
+            conv->scaleLines(src, stride, dst, dst_stride, y0, y1, &buffers);
+        else
+            conv->convertLines(src, stride, dst, dst_stride, y0, y1);
+        done->release();
+    }
+
+    ImageConverterSIMDPrivate *conv;
+    const quint8 *const *src;
+    const int *stride;
+    quint8 *dst;
+    int dst_stride;
+    int y0, y1;
+    bool scale;
+    ScaleBuffers buffers;
+    QSemaphore *done;
+};
+
+ImageConverterSIMDPrivate::~ImageConverterSIMDPrivate()
+{
+    if (ff) {
+        delete ff;
+        ff = 0;
+    }
+    qDeleteAll(tasks);
+    tasks.clear();
+}
+
+void ImageConverterSIMDPrivate::computeTaps()
+{
+    if (taps_fmt == fmt_in && taps_w_in == w_in && taps_h_in == h_in
+            && taps_w_out == w_out && taps_h_out == h_out)
+        return;
+    taps_fmt = fmt_in;
+    taps_w_in = w_in;
+    taps_h_in = h_in;
+    taps_w_out = w_out;
+    taps_h_out = h_out;
+    const int cw_in = (w_in + 1) >> 1;
+    const int cw_out = (w_out + 1) >> 1;
+    const double sx = double(w_in)/double(w_out);
+    const double sy = double(h_in)/double(h_out);
+    //pixel centers. the chroma of output pixel 2i and 2i+1 is sampled at 2i+0.5
+    x_luma.compute(w_out, sx, 0.5*sx - 0.5, w_in);
+    x_chroma.compute(cw_out, sx, (sx - 0.5)*0.5, cw_in);
+    y_luma.compute(h_out, sy, 0.5*sy - 0.5, h_in);
+    if (fmt_in == PIX_FMT_YUV422P) {
+        y_chroma = y_luma;
+    } else {
+        //the chroma line i is at luma 2i+0.5
+        y_chroma.compute(h_out, 0.5*sy, (0.5*sy - 1.0)*0.5, (h_in + 1) >> 1);
+    }
+}
+
+void ImageConverterSIMDPrivate::convertLines(const quint8 *const src[], const int stride[], quint8 *dst, int dstStride, int y0, int y1)
+{
+    const SIMDKernels &k = simdKernels(kernels);
+    const bool swap_rb = fmt_out == PIX_FMT_BGR32;
+    const int cshift = fmt_in == PIX_FMT_YUV422P ? 0 : 1;
+    for (int y = y0; y < y1; ++y) {
+        const int cy = y >> cshift;
+        quint8 *line = dst + y*dstStride;
+        if (fmt_in == PIX_FMT_NV12)
+            k.nv12torgb(src[0] + y*stride[0], src[1] + cy*stride[1], 0, line, w_out, swap_rb);
+        else
+            k.yuv2rgb(src[0] + y*stride[0], src[1] + cy*stride[1], src[2] + cy*stride[2], line, w_out, swap_rb);
+    }
+}
+
+//blend 2 source lines vertically then sample horizontally. no intermediate picture
+void ImageConverterSIMDPrivate::scaleLines(const quint8 *const src[], const int stride[], quint8 *dst, int dstStride, int y0, int y1, ScaleBuffers *buf)
+{
+    const SIMDKernels &k = simdKernels(kernels);
+    const bool swap_rb = fmt_out == PIX_FMT_BGR32;
+    const int cw_in = (w_in + 1) >> 1;
+    buf->reserve(qMax(w_in, 2*cw_in) + 32, w_out + 32, ((w_out + 1) >> 1) + 32);
+    quint8 *tmp = (quint8*)buf->blended.data();
+    quint8 *ly = (quint8*)buf->line_y.data();
+    quint8 *lu = (quint8*)buf->line_u.data();
+    quint8 *lv = (quint8*)buf->line_v.data();
+#define QTAV_BLEND_LINE(plane, taps, y, width) \
+    (taps.f[y] == 0 ? src[plane] + taps.i0[y]*stride[plane] \
+        : (k.blend(src[plane] + taps.i0[y]*stride[plane], src[plane] + taps.i1[y]*stride[plane], taps.f[y], tmp, width), tmp))
+    for (int y = y0; y < y1; ++y) {
+        scale_line(QTAV_BLEND_LINE(0, y_luma, y, w_in), 1, x_luma, ly);
+        if (fmt_in == PIX_FMT_NV12) {
+            const quint8 *uv = QTAV_BLEND_LINE(1, y_chroma, y, 2*cw_in);
+            scale_line(uv, 2, x_chroma, lu);
+            scale_line(uv + 1, 2, x_chroma, lv);
+        } else {
+            scale_line(QTAV_BLEND_LINE(1, y_chroma, y, cw_in), 1, x_chroma, lu);
+            scale_line(QTAV_BLEND_LINE(2, y_chroma, y, cw_in), 1, x_chroma, lv);
+        }
+        k.yuv2rgb(ly, lu, lv, dst + y*dstStride, w_out, swap_rb);
+    }
+#undef QTAV_BLEND_LINE
+}
+
+void ImageConverterSIMDPrivate::convertBands(int bands, bool scale, const quint8 *const src[], const int stride[], quint8 *dst, int dstStride)
+{
+    const int band_h = (h_out + bands - 1)/bands;
+    bands = (h_out + band_h - 1)/band_h;
+    while (tasks.size() < bands)
+        tasks.append(new SIMDBandTask());
+    QSemaphore done;
+    for (int i = 0; i < bands; ++i) {
+        SIMDBandTask &task = *tasks[i];
+        task.conv = this;
+        task.src = src;
+        task.stride = stride;
+        task.dst = dst;
+        task.dst_stride = dstStride;
+        task.y0 = i*band_h;
+        task.y1 = qMin(task.y0 + band_h, h_out);
+        task.scale = scale;
+        task.done = &done;
+    }
+    for (int i = 1; i < bands; ++i)
+        imageConvertThreadPool()->start(tasks[i]);
+    tasks[0]->run(); //in current thread
+    done.acquire(bands);
+}
+
+bool ImageConverterSIMDPrivate::convertFF(const quint8 *const srcSlice[], const int srcStride[], quint8 *const dst[], const int dstStride[])
+{
+    if (!ff) {
+        ff = ImageConverterFactory::create(ImageConverterId_FF);
+        if (!ff)
+            return false;
+    }
+    ff->setInFormat(fmt_in);
+    ff->setOutFormat(fmt_out);
+    ff->setInSize(w_in, h_in);
+    ff->setOutSize(w_out, h_out);
+    ff->setInterlaced(interlaced);
+    ff->setThreads(threads);
+    return ff->convert(srcSlice, srcStride, dst, dstStride);
+}
+
+ImageConverterSIMD::ImageConverterSIMD(Kernels kernels)
+    :ImageConverter(*new ImageConverterSIMDPrivate())
+{
+    d_func().kernels = kernels;
+}
+
+ImageConverterSIMD::Kernels ImageConverterSIMD::kernels() const
+{
+    return simdKernels(d_func().kernels).kernels;
+}
+
+bool ImageConverterSIMD::convert(const quint8 *const srcSlice[], const int srcStride[], quint8 *const dst[], const int dstStride[])
+{
+    DPTR_D(ImageConverterSIMD);
+    if (d.w_in == 0 || d.h_in == 0 || d.w_out == 0 || d.h_out == 0)
+        return false;
+    //ImageConverterFF deinterlaces
+    if (!d.isSupported() || d.interlaced)
+        return d.convertFF(srcSlice, srcStride, dst, dstStride);
+    const bool scale = d.w_in != d.w_out || d.h_in != d.h_out;
+    if (scale)
+        d.computeTaps();
+    const int bands = d.bandCount();
+    if (bands > 1)
+        d.convertBands(bands, scale, srcSlice, srcStride, dst[0], dstStride[0]);
+    else if (scale)
+        d.scaleLines(srcSlice, srcStride, dst[0], dstStride[0], 0, d.h_out, &d.buffers);
+    else
+        d.convertLines(srcSlice, srcStride, dst[0], dstStride[0], 0, d.h_out);
+    return true;
+}
+
+} //namespace QtAV
@@ -21,9 +21,23 @@
 
 #include <QtAV/ImageRenderer.h>
 #include <private/ImageRenderer_p.h>
+#include <QtCore/QCoreApplication>
 
 namespace QtAV {
 
+QEvent::Type ImageRendererPrivate::repaintEventType()
+{
+    static const QEvent::Type type = (QEvent::Type)QEvent::registerEventType();
+    return type;
+}
+
+void ImageRendererPrivate::scheduleRepaint(QObject *receiver)
+{
+    if (!repaint_pending.testAndSetOrdered(0, 1))
+        return;
+    QCoreApplication::postEvent(receiver, new QEvent(repaintEventType()));
+}
+
 ImageRenderer::ImageRenderer()
     :VideoRenderer(*new ImageRendererPrivate())
 {
@@ -43,45 +57,44 @@ QImage ImageRenderer::currentFrameImage() const
     return d_func().image;
 }
 */
+
+int ImageRenderer::overwrittenFrames() const
+{
+    return const_cast<QAtomicInt&>(d_func().overwritten).fetchAndAddOrdered(0);
+}
+
+int ImageRenderer::droppedFrames() const
+{
+    return const_cast<QAtomicInt&>(d_func().dropped).fetchAndAddOrdered(0);
+}
+
 //FIXME: why crash if QImage use widget size?
 void ImageRenderer::convertData(const QByteArray &data)
 {
     DPTR_D(ImageRenderer);
-    //int ss = 4*d.src_width*d.src_height*sizeof(char);
-    //if (ss != data.size())
-    //    qDebug("src size=%d, data size=%d", ss, data.size());
-    //if (d.src_width != d.renderer_width || d.src_height != d.renderer_height)
-    //    return;
+    //the size may be changed after the frame is converted. do not read beyond the data
+    if (data.size() < 4*d.src_width*d.src_height) {
+        d.dropped.fetchAndAddOrdered(1);
+        return;
+    }
     /*
      * QImage constructed from memory do not deep copy the data, data should be available throughout
-     * image's lifetime and not be modified. painting image happens in main thread, we must ensure the
-     * image data is not changed if not use the original frame size, so we need the lock.
-     * In addition, the data passed by ref, so even if we lock, the original data may changed in decoder
-     * (ImageConverter), so we need a copy of this data(not deep copy) to ensure the image's data not changes before it
-     * is painted.
-     * But if we use the fixed original frame size, the data address and size always the same, so we can
-     * avoid the lock and use the ref data directly and safely
+     * image's lifetime and not be modified. The slot holds a reference of the frame, so the decoder will not
+     * reuse the buffer until the slot is written again. The painter only reads the published slots
      */
-    if (!d.scale_in_renderer) {
-        /*if lock is required, do not use locker in if() scope, it will unlock outside the scope*/
-        d.img_mutex.lock();
-        d.data = data;
-        //qDebug("data address = %p, %p", data.data(), d.data.data());
-    #if QT_VERSION >= QT_VERSION_CHECK(4, 0, 0)
-        d.image = QImage((uchar*)d.data.data(), d.src_width, d.src_height, QImage::Format_RGB32);
-    #else
-        d.image = QImage((uchar*)d.data.data(), d.src_width, d.src_height, 16, NULL, 0, QImage::IgnoreEndian);
-    #endif
-        d.img_mutex.unlock();
-    } else {
-        //qDebug("data address = %p", data.data());
-        //Format_RGB32 is fast. see document
+    ImageRendererPrivate::Frame &frame = d.frames[d.write_index];
+    frame.data = data;
+    //Format_RGB32 is fast. see document
 #if QT_VERSION >= QT_VERSION_CHECK(4, 0, 0)
-        d.image = QImage((uchar*)data.data(), d.src_width, d.src_height, QImage::Format_RGB32);
+    frame.image = QImage((const uchar*)frame.data.constData(), d.src_width, d.src_height, QImage::Format_RGB32);
 #else
-    d.image = QImage((uchar*)data.data(), d.src_width, d.src_height, 16, NULL, 0, QImage::IgnoreEndian);
+    frame.image = QImage((uchar*)frame.data.constData(), d.src_width, d.src_height, 16, NULL, 0, QImage::IgnoreEndian);
 #endif
-    }
+    d.publish();
+    //the new write slot is never painted. release its frame so the decoder can reuse the buffer
+    ImageRendererPrivate::Frame &stale = d.frames[d.write_index];
+    stale.image = QImage();
+    stale.data = QByteArray();
 }
 
 } //namespace QtAV
@@ -0,0 +1,250 @@
+/******************************************************************************
+    QtAV:  Media play library based on Qt and FFmpeg
+    Copyright (C) 2012-2013 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+
+#include <private/KeyFrameIndex_p.h>
+#include <private/MappedIO_p.h>
+#include <QtAV/QtAV_Compat.h>
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+
+namespace QtAV {
+
+static const quint32 kIndexMagic = 0x51415649; //"QAVI"
+static const quint32 kIndexVersion = 1;
+static const int kBatch = 64; //entries appended to the index at once while scanning
+
+KeyFrameIndex::KeyFrameIndex(QObject *parent)
+    :QThread(parent),stream(-1),file_size(0),file_mtime(0),stopped(false),complete(false)
+{
+}
+
+KeyFrameIndex::~KeyFrameIndex()
+{
+    stop();
+}
+
+void KeyFrameIndex::build(const QString &fileName, int streamIndex)
+{
+    stop();
+    {
+        QMutexLocker lock(&mutex);
+        Q_UNUSED(lock);
+        entries.clear();
+    }
+    complete = false;
+    stopped = false;
+    file_name = fileName;
+    stream = streamIndex;
+    QFileInfo fi(fileName);
+    if (!fi.isFile()) {
+        qDebug("[KeyFrameIndex] not a local file: %s", qPrintable(fileName));
+        return;
+    }
+    file_size = fi.size();
+    file_mtime = fi.lastModified().toMSecsSinceEpoch();
+    if (load()) {
+        qDebug("[KeyFrameIndex] %d key frames loaded from %s", size(), qPrintable(indexFile(file_name)));
+        return;
+    }
+    start(QThread::LowestPriority);
+}
+
+void KeyFrameIndex::stop()
+{
+    stopped = true;
+    wait();
+}
+
+bool KeyFrameIndex::isComplete() const
+{
+    return complete;
+}
+
+int KeyFrameIndex::size() const
+{
+    QMutexLocker lock(&mutex);
+    Q_UNUSED(lock);
+    return entries.size();
+}
+
+bool KeyFrameIndex::find(qreal pts, bool before, Entry *entry) const
+{
+    QMutexLocker lock(&mutex);
+    Q_UNUSED(lock);
+    if (entries.isEmpty())
+        return false;
+    //an unscanned key frame may be nearer
+    if (!complete && pts >= entries.last().pts)
+        return false;
+    //the first entry later than pts
+    int lo = 0, hi = entries.size();
+    while (lo < hi) {
+        const int mid = (lo + hi)/2;
+        if (entries[mid].pts <= pts)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    int i = lo - 1;
+    if (!before && lo < entries.size() && (i < 0 || entries[lo].pts - pts < pts - entries[i].pts))
+        i = lo;
+    if (i < 0)
+        return false;
+    *entry = entries[i];
+    return true;
+}
+
+QString KeyFrameIndex::indexFile(const QString &fileName)
+{
+    return fileName + ".qtavidx";
+}
+
+bool KeyFrameIndex::load()
+{
+    QFile f(indexFile(file_name));
+    if (!f.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream ds(&f);
+    quint32 magic = 0, version = 0;
+    qint64 media_size = 0, mtime = 0;
+    qint32 index = -1, count = 0;
+    ds >> magic >> version >> media_size >> mtime >> index >> count;
+    if (ds.status() != QDataStream::Ok || magic != kIndexMagic || version != kIndexVersion) {
+        qWarning("[KeyFrameIndex] invalid index file %s", qPrintable(f.fileName()));
+        return false;
+    }
+    if (media_size != file_size || mtime != file_mtime || index != stream) {
+        qDebug("[KeyFrameIndex] the media is changed. rebuild the index");
+        return false;
+    }
+    //an entry is 16 bytes
+    if (count < 0 || (qint64)count*16LL > f.size()) {
+        qWarning("[KeyFrameIndex] invalid index file %s", qPrintable(f.fileName()));
+        return false;
+    }
+    QVector<Entry> saved(count);
+    for (int i = 0; i < count; ++i)
+        ds >> saved[i].pts >> saved[i].pos;
+    if (ds.status() != QDataStream::Ok) {
+        qWarning("[KeyFrameIndex] truncated index file %s", qPrintable(f.fileName()));
+        return false;
+    }
+    QMutexLocker lock(&mutex);
+    Q_UNUSED(lock);
+    entries = saved;
+    complete = true;
+    return true;
+}
+
+bool KeyFrameIndex::save() const
+{
+    QFile f(indexFile(file_name));
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning("[KeyFrameIndex] can not save the index to %s: %s", qPrintable(f.fileName()), qPrintable(f.errorString()));
+        return false;
+    }
+    QDataStream ds(&f);
+    QMutexLocker lock(&mutex);
+    Q_UNUSED(lock);
+    ds << kIndexMagic << kIndexVersion << file_size << file_mtime << (qint32)stream << (qint32)entries.size();
+    for (int i = 0; i < entries.size(); ++i)
+        ds << entries[i].pts << entries[i].pos;
+    return ds.status() == QDataStream::Ok;
+}
+
+int KeyFrameIndex::interruptCallback(void *obj)
+{
+    return static_cast<KeyFrameIndex*>(obj)->stopped ? 1 : 0;
+}
+
+void KeyFrameIndex::run()
+{
+    MappedIO mapped; //outlives ctx
+    AVFormatContext *ctx = avformat_alloc_context();
+    ctx->interrupt_callback.callback = interruptCallback;
+    ctx->interrupt_callback.opaque = this;
+    if (mapped.open(file_name)) {
+        ctx->pb = mapped.context();
+        ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
+    }
+    int ret = avformat_open_input(&ctx, qPrintable(file_name), NULL, NULL);
+    if (ret < 0) {
+        qWarning("[KeyFrameIndex] can not open %s: %s", qPrintable(file_name), av_err2str(ret));
+        return;
+    }
+    ret = avformat_find_stream_info(ctx, NULL);
+    if (ret < 0 || stream < 0 || stream >= (int)ctx->nb_streams) {
+        qWarning("[KeyFrameIndex] can not find stream %d", stream);
+        avformat_close_input(&ctx);
+        return;
+    }
+    //the packets of the other streams are not returned. the key flag may be set by the parser, so the non-key
+    //packets of the indexed stream are not discarded by the demuxer
+    for (unsigned int i = 0; i < ctx->nb_streams; ++i)
+        ctx->streams[i]->discard = (int)i == stream ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+    const double time_base = av_q2d(ctx->streams[stream]->time_base);
+    QVector<Entry> found;
+    found.reserve(kBatch);
+    qreal last_pts = -1;
+    AVPacket packet;
+    while (!stopped) {
+        ret = av_read_frame(ctx, &packet);
+        if (ret < 0)
+            break;
+        if (packet.stream_index == stream && (packet.flags & AV_PKT_FLAG_KEY) && packet.pos >= 0) {
+            //seek() uses the pts as the seek target and the clock, and frames are timed by their pts. dts is earlier
+            //if the key frame is reordered, e.g. the first frame of an open GOP
+            const int64_t ts = packet.pts != (int64_t)AV_NOPTS_VALUE ? packet.pts : packet.dts;
+            if (ts != (int64_t)AV_NOPTS_VALUE && ts*time_base > last_pts) {
+                Entry e;
+                e.pts = last_pts = ts*time_base;
+                e.pos = packet.pos;
+                found.append(e);
+            }
+        }
+        av_free_packet(&packet);
+        if (found.size() >= kBatch) {
+            QMutexLocker lock(&mutex);
+            Q_UNUSED(lock);
+            entries += found;
+            found.clear();
+        }
+    }
+    avformat_close_input(&ctx);
+    {
+        QMutexLocker lock(&mutex);
+        Q_UNUSED(lock);
+        entries += found;
+    }
+    if (stopped || ret != AVERROR_EOF) {
+        if (!stopped)
+            qWarning("[KeyFrameIndex] scanning stopped: %s", av_err2str(ret));
+        return;
+    }
+    complete = true;
+    qDebug("[KeyFrameIndex] %d key frames indexed", size());
+    save();
+}
+
+} //namespace QtAV
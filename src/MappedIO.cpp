@@ -0,0 +1,163 @@
+/******************************************************************************
+    QtAV:  Media play library based on Qt and FFmpeg
+    Copyright (C) 2012-2013 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+
+#include <private/MappedIO_p.h>
+#include <QtAV/QtAV_Compat.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif //Q_OS_UNIX
+
+namespace QtAV {
+
+static const int kBufferSize = 64*1024; //the context's buffer. larger reads are copied to the caller directly
+static const qint64 kAdviseAhead = 4*1024*1024; //bytes advised to be needed ahead of the read position
+
+MappedIO::MappedIO()
+    :data(0),data_size(0),pos(0),advised(0),io(0)
+{
+}
+
+MappedIO::~MappedIO()
+{
+    close();
+}
+
+bool MappedIO::open(const QString &fileName)
+{
+    close();
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    data_size = file.size();
+    //QFile::map() fails for empty files, pipes and devices
+    if (data_size <= 0 || file.isSequential()) {
+        file.close();
+        return false;
+    }
+    data = file.map(0, data_size);
+    if (!data) {
+        qWarning("[MappedIO] can not map %s: %s", qPrintable(fileName), qPrintable(file.errorString()));
+        file.close();
+        return false;
+    }
+#ifdef Q_OS_UNIX
+    madvise(data, data_size, MADV_SEQUENTIAL);
+#endif //Q_OS_UNIX
+    pos = advised = 0;
+    adviseAhead();
+    uint8_t *buffer = (uint8_t*)av_malloc(kBufferSize);
+    io = avio_alloc_context(buffer, kBufferSize, 0, this, &MappedIO::read, 0, &MappedIO::seek);
+    if (!io) {
+        av_free(buffer);
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedIO::close()
+{
+    if (io) {
+        av_free(io->buffer); //may be reallocated by the context
+        av_free(io);
+        io = 0;
+    }
+    if (data) {
+        file.unmap(data);
+        data = 0;
+    }
+    if (file.isOpen())
+        file.close();
+    data_size = pos = advised = 0;
+}
+
+bool MappedIO::isOpen() const
+{
+    return !!io;
+}
+
+AVIOContext* MappedIO::context() const
+{
+    return io;
+}
+
+int MappedIO::read(void *opaque, uint8_t *buf, int buf_size)
+{
+    MappedIO *m = static_cast<MappedIO*>(opaque);
+    const qint64 left = m->data_size - m->pos;
+    if (left <= 0)
+        return AVERROR_EOF;
+    const int n = (int)qMin<qint64>(buf_size, left);
+    memcpy(buf, m->data + m->pos, n);
+    m->pos += n;
+    if (m->pos + kAdviseAhead/2 > m->advised)
+        m->adviseAhead();
+    return n;
+}
+
+int64_t MappedIO::seek(void *opaque, int64_t offset, int whence)
+{
+    MappedIO *m = static_cast<MappedIO*>(opaque);
+    qint64 p = 0;
+    switch (whence & ~AVSEEK_FORCE) {
+    case AVSEEK_SIZE:
+        return m->data_size;
+    case SEEK_SET:
+        p = offset;
+        break;
+    case SEEK_CUR:
+        p = m->pos + offset;
+        break;
+    case SEEK_END:
+        p = m->data_size + offset;
+        break;
+    default:
+        return -1;
+    }
+    if (p < 0 || p > m->data_size)
+        return -1;
+    //jumped out of the advised region
+    if (p < m->advised - kAdviseAhead || p > m->advised)
+        m->advised = p;
+    m->pos = p;
+    m->adviseAhead();
+    return p;
+}
+
+void MappedIO::adviseAhead()
+{
+    if (advised >= data_size || advised >= pos + kAdviseAhead)
+        return;
+    const qint64 end = qMin(pos + kAdviseAhead, data_size);
+#ifdef Q_OS_UNIX
+    //the address must be page aligned. the mapping starts at a page
+    static const qint64 page_mask = (qint64)sysconf(_SC_PAGESIZE) - 1;
+    const qint64 start = qMax(advised, pos) & ~page_mask;
+    madvise(data + start, end - start, MADV_WILLNEED);
+#endif //Q_OS_UNIX
+    advised = end;
+}
+
+} //namespace QtAV
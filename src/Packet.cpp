@@ -19,13 +19,203 @@
     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ******************************************************************************/
 
+
 #include <QtAV/Packet.h>
+#include <QtAV/QtAV_Compat.h>
 
 namespace QtAV {
 
+class PacketPrivate : public QSharedData
+{
+public:
+    PacketPrivate():time_base(0) {
+        av_init_packet(&avpkt);
+        avpkt.data = 0;
+        avpkt.size = 0;
+    }
+    ~PacketPrivate() {
+        av_free_packet(&avpkt);
+    }
+
+    AVPacket avpkt;
+    double time_base;
+};
+
+Packet Packet::fromAVPacket(AVPacket *avpkt, double time_base)
+{
+    Packet pkt;
+    if (!avpkt)
+        return pkt;
+    pkt.d = new PacketPrivate();
+    /*
+     * av_dup_packet() does nothing if the payload is already owned by the packet(the most cases of av_read_frame),
+     * otherwise the payload is in the demuxer's internal buffer and it must be duplicated
+     */
+    if (av_dup_packet(avpkt) < 0) {
+        qWarning("[Packet] av_dup_packet failed");
+        av_free_packet(avpkt);
+        pkt.d = 0;
+        return pkt;
+    }
+    //move the payload, side data and destructor. avpkt does not own them any more
+    pkt.d->avpkt = *avpkt;
+    av_init_packet(avpkt);
+    avpkt->data = 0;
+    avpkt->size = 0;
+
+    pkt.d->time_base = time_base;
+    const AVPacket &p = pkt.d->avpkt;
+    pkt.hasKeyFrame = !!(p.flags & AV_PKT_FLAG_KEY);
+    pkt.data = QByteArray::fromRawData((const char*)p.data, p.size);
+    //if (packet.dts == AV_NOPTS_VALUE && )
+    if (p.dts != AV_NOPTS_VALUE) //has B-frames
+        pkt.pts = p.dts;
+    else if (p.pts != AV_NOPTS_VALUE)
+        pkt.pts = p.pts;
+    else
+        pkt.pts = 0;
+    pkt.pts *= time_base;
+    if (p.duration > 0)
+        pkt.duration = p.duration * time_base;
+    else
+        pkt.duration = 0;
+    return pkt;
+}
+
 Packet::Packet()
-    :pts(0),duration(0)
+    :hasKeyFrame(false),pts(0),duration(0),serial(0)
+{
+}
+
+Packet::~Packet()
+{
+}
+
+Packet::Packet(const Packet &other)
+    :hasKeyFrame(other.hasKeyFrame),data(other.data),pts(other.pts),duration(other.duration),serial(other.serial),d(other.d)
+{
+}
+
+Packet& Packet::operator=(const Packet &other)
+{
+    if (this == &other)
+        return *this;
+    d = other.d;
+    hasKeyFrame = other.hasKeyFrame;
+    data = other.data;
+    pts = other.pts;
+    duration = other.duration;
+    serial = other.serial;
+    return *this;
+}
+
+const AVPacket* Packet::asAVPacket() const
+{
+    if (!d)
+        return 0;
+    return &d->avpkt;
+}
+
+double Packet::timeBase() const
+{
+    if (!d)
+        return 0;
+    return d->time_base;
+}
+
+
+//QAtomicInt api changes in Qt5. ordered read-modify-write works for both
+static inline int atomicLoad(const QAtomicInt& a)
+{
+    return const_cast<QAtomicInt&>(a).fetchAndAddOrdered(0);
+}
+
+static const qreal kMaxPtsGap = 10.0; //larger gap is a discontinuity and is not counted
+
+PacketQueue::PacketQueue()
+    :PacketQueueBase()
+    ,bytes_high(0),bytes_low(0),duration_high(0),duration_low(0)
+    ,bytes_buffered(0),duration_buffered(0)
+    ,put_pts(-1),take_pts(-1)
+{
+}
+
+void PacketQueue::setBytesLimit(int high, int low)
+{
+    bytes_high = qMax(high, 0);
+    bytes_low = low < 0 ? bytes_high/2 : qMin(low, bytes_high);
+}
+
+int PacketQueue::bytesLimit() const
+{
+    return bytes_high;
+}
+
+void PacketQueue::setDurationLimit(qreal high, qreal low)
+{
+    duration_high = qMax(int(high*1000000.0), 0);
+    duration_low = low < 0 ? duration_high/2 : qMin(int(low*1000000.0), duration_high);
+}
+
+qreal PacketQueue::durationLimit() const
+{
+    return qreal(duration_high)/1000000.0;
+}
+
+int PacketQueue::bytes() const
+{
+    return atomicLoad(bytes_buffered);
+}
+
+qreal PacketQueue::bufferedDuration() const
+{
+    return qreal(atomicLoad(duration_buffered))/1000000.0;
+}
+
+bool PacketQueue::checkFull() const
+{
+    if (PacketQueueBase::checkFull())
+        return true;
+    if (bytes_high > 0 && bytes() >= bytes_high)
+        return true;
+    if (duration_high > 0 && atomicLoad(duration_buffered) >= duration_high)
+        return true;
+    return false;
+}
+
+bool PacketQueue::checkEnough() const
+{
+    if (PacketQueueBase::checkEnough())
+        return true;
+    if (bytes_high > 0 && bytes() >= bytes_low)
+        return true;
+    if (duration_high > 0 && atomicLoad(duration_buffered) >= duration_low)
+        return true;
+    return false;
+}
+
+void PacketQueue::onPut(const Packet &packet)
+{
+    bytes_buffered.fetchAndAddOrdered(packet.data.size());
+    duration_buffered.fetchAndAddOrdered(ptsDelta(&put_pts, packet));
+}
+
+void PacketQueue::onTake(const Packet &packet)
+{
+    bytes_buffered.fetchAndAddOrdered(-packet.data.size());
+    duration_buffered.fetchAndAddOrdered(-ptsDelta(&take_pts, packet));
+}
+
+int PacketQueue::ptsDelta(qreal *last, const Packet &packet)
 {
+    if (!packet.isValid()) //eof or flush packet
+        return 0;
+    const qreal dt = packet.pts - *last;
+    const bool first = *last < 0;
+    *last = packet.pts;
+    if (first || dt <= 0 || dt > kMaxPtsGap)
+        return 0;
+    return int(dt*1000000.0);
 }
 
 } //namespace QtAV
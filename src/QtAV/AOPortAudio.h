@@ -37,6 +37,24 @@ public:
 
     bool open();
     bool close();
+    virtual qreal latency() const;
+    //pull mode: drops the samples in the ring. safe while the callback is running
+    virtual void clear();
+
+    /*
+     * Pull mode: write() puts the samples into a lock-free ring and the PortAudio callback reads them, so the
+     * audio thread never blocks in the driver. Otherwise the samples are written by the blocking Pa_WriteStream().
+     * Default is true. Takes effect in open()
+     */
+    void setPullMode(bool pull);
+    bool isPullMode() const;
+    //use the device's low latency and a smaller ring. default is false. Takes effect in open()
+    void setLowLatency(bool low);
+    bool isLowLatency() const;
+    //pull mode only. times the callback has not enough samples
+    int underruns() const;
+    //pull mode only. the filled part of the ring, [0, 1]
+    qreal bufferLevel() const;
 
 protected:
     bool write();
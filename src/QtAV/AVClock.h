@@ -24,18 +24,20 @@
 
 #include <QtAV/QtAV_Global.h>
 #include <QtCore/QObject>
-#if QT_VERSION >= QT_VERSION_CHECK(4, 7, 0)
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
 #include <QtCore/QElapsedTimer>
-#else
-#include <QtCore/QTimer>
-typedef QTimer QElapsedTimer
-#endif
 
 /*
  * AVClock is created by AVPlayer. The only way to access AVClock is through AVPlayer::masterClock()
  * The default clock type is Audio's clock, i.e. vedio synchronizes to audio. If audio stream is not
  * detected, then the clock will set to External clock automatically.
  * I name it ExternalClock because the clock can be corrected outside, though it is a clock inside AVClock
+ *
+ * The clock is a snapshot (base pts, base time, rate) published by the writers (audio thread, demux thread
+ * and the player). value() is base pts + (now - base time) * rate, computed from a monotonic nanosecond
+ * timer without modifying the clock. Readers never lock: the snapshot is guarded by a sequence counter
+ * and a reader retries if a writer changed it in the middle of the read. Writers are serialized by a mutex.
  */
 namespace QtAV {
 
@@ -59,10 +61,21 @@ public:
      */
     void setClockAuto(bool a);
     bool isClockAuto() const;
-    /*in seconds*/
+    /*
+     * playback rate multiplier. 1.0 is the normal speed. the external clock runs at this rate. the audio
+     * clock interpolates at this rate between updates, the pts and delay are given in media time.
+     */
+    void setSpeed(double speed);
+    inline double speed() const;
+    /*in seconds. the pts of the last update*/
     inline double pts() const;
-    inline double value() const; //the real timestamp: pts + delay
-    inline void updateValue(double pts); //update the pts
+    /*
+     * the real timestamp. For AudioClock, it is the pts being played by the device, interpolated with a monotonic
+     * timer since the last update but not beyond pts + delay, i.e. the samples written.
+     * no side effect. thread safe and lock free
+     */
+    inline double value() const;
+    inline void updateValue(double pts); //update the pts. For AudioClock, the pts being played
     /*used when seeking and correcting from external*/
     void updateExternalClock(qint64 msecs);
     /*external clock outside still running, so it's more accurate for syncing multiple clocks serially*/
@@ -70,7 +83,7 @@ public:
 
     inline void updateVideoPts(double pts);
     inline double videoPts() const;
-    inline double delay() const; //playing audio spends some time
+    inline double delay() const; //the written audio not played yet, i.e. the output's latency
     inline void updateDelay(double delay);
 
 signals:
@@ -90,32 +103,84 @@ public slots:
     void reset();
 
 private:
+    struct Snapshot {
+        double pts; //value at base_ns
+        qint64 base_ns; //monotonic time when pts was set
+        double rate; //0 if not running
+        double limit; //max advance from pts in seconds. <0: no limit
+    };
+    inline qint64 now() const;
+    inline Snapshot snapshot() const;
+    //call with write_mutex locked
+    void publish(const Snapshot& s);
+    void setBase(double pts, bool run, double limit); //base time is now
+
     bool auto_clock;
-    ClockType clock_type;
-    mutable double pts_;
-    double pts_v;
-    double delay_;
-    mutable QElapsedTimer timer;
+    volatile int clock_type;
+    volatile bool running; //external clock is started and not paused
+    volatile double speed_;
+    volatile double pts_v;
+    volatile double delay_;
+    QElapsedTimer epoch; //monotonic time source, started once
+    /*
+     * seqlock. odd while a writer is updating snap. readers retry if it is odd or changed during the read.
+     * the fields are read by other threads while written, so volatile to avoid being cached in registers
+     */
+    QAtomicInt seq;
+    volatile double snap_pts, snap_rate, snap_limit;
+    volatile qint64 snap_ns;
+    QMutex write_mutex;
 };
 
-double AVClock::value() const
+qint64 AVClock::now() const
+{
+    return epoch.nsecsElapsed();
+}
+
+AVClock::Snapshot AVClock::snapshot() const
 {
-    if (clock_type == AudioClock) {
-        return pts_ + delay_;
-    } else {
-        if (timer.isValid())
-            return pts_ += double(timer.restart()) * kThousandth;
-        else {//timer is paused
-            qDebug("clock is paused. return the last value %f", pts_);
-            return pts_;
-        }
+    QAtomicInt &s = const_cast<QAtomicInt&>(seq);
+    Snapshot snap;
+    int s0;
+    forever {
+        s0 = s.fetchAndAddOrdered(0);
+        if (s0 & 1)
+            continue; //a writer is updating
+        snap.pts = snap_pts;
+        snap.base_ns = snap_ns;
+        snap.rate = snap_rate;
+        snap.limit = snap_limit;
+        if (s.fetchAndAddOrdered(0) == s0)
+            break;
     }
+    return snap;
+}
+
+double AVClock::speed() const
+{
+    return speed_;
+}
+
+double AVClock::pts() const
+{
+    return snapshot().pts;
+}
+
+double AVClock::value() const
+{
+    const Snapshot s = snapshot();
+    if (s.rate == 0)
+        return s.pts;
+    double dt = double(now() - s.base_ns) * 1e-9 * s.rate;
+    if (s.limit >= 0 && dt > s.limit)
+        dt = s.limit;
+    return s.pts + dt;
 }
 
 void AVClock::updateValue(double pts)
 {
     if (clock_type == AudioClock)
-        pts_ = pts;
+        setBase(pts, true, delay_);
 }
 
 void AVClock::updateVideoPts(double pts)
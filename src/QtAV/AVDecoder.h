@@ -30,6 +30,7 @@ struct AVFrame;
 
 namespace QtAV {
 
+class Packet;
 class AVDecoderPrivate;
 class Q_EXPORT AVDecoder
 {
@@ -43,6 +44,11 @@ public:
     /*not available if AVCodecContext == 0*/
     bool isAvailable() const;
     virtual bool decode(const QByteArray& encoded) = 0; //decode AVPacket?
+    /*
+     * decode the packet's AVPacket directly without copying the payload. Flags and side data are kept.
+     * The default implementation decodes packet.data
+     */
+    virtual bool decode(const Packet& packet);
     QByteArray data() const; //decoded data
 
 protected:
@@ -40,11 +40,27 @@ public:
     void setDemuxer(AVDemuxer *dmx);
     void setAudioThread(AVThread *thread);
     void setVideoThread(AVThread *thread);
-    void seek(qreal pos);
+    /*
+     * Seeking is done in the demuxing thread and these functions return immediately. A request replaces the
+     * one not performed yet, i.e. the latest one wins. seekForward() and seekBackward() are relative to the
+     * pending request if any. If paused, the frame at the new position is displayed.
+     */
+    void seek(qreal pos); //pos: [0,1]
     void seekForward();
     void seekBackward();
+    /*
+     * Switch the audio stream without reopening the file, see AVDemuxer::setAudioStream(). If demuxing, it's done
+     * in the demuxing thread: the audio thread is restarted with the new codec and the playback continues from the
+     * current position. If paused, it's done when resumed. Returns false if index is not an audio stream
+     */
+    bool setAudioStream(int index);
     //AVDemuxer* demuxer
     bool isPaused() const;
+
+signals:
+    //a seek request is performed. pos: the position in seconds playing continues from
+    void seekFinished(qreal pos);
+
 public slots:
     void stop();
     void pause(bool p);
@@ -58,13 +74,26 @@ protected:
     bool tryPause();
 
 private:
-    bool paused, seeking;
+    void seekBy(qreal secs);
+    //performs the latest seek request in this thread and flushes the decoding threads
+    void processSeekRequest();
+    //performs the audio stream switch request in this thread. returns true if switched
+    bool processAudioStreamRequest();
+
+    volatile bool paused;
     volatile bool end;
     AVDemuxer *demuxer;
     AVThread *audio_thread, *video_thread;
     int audio_stream, video_stream;
     QMutex buffer_mutex;
-    QWaitCondition cond, seek_cond;
+    QWaitCondition cond;
+    QMutex seek_mutex;
+    qreal seek_request; //position in [0,1] not performed yet. <0: none
+    int audio_stream_request; //setAudioStream() not performed yet. -2: none
+    qreal landing; //the accurate seek target. <0: the first packet's pts
+    bool seek_landing; //seekFinished() is not emitted for the last seek
+    bool seek_step; //paused and seeked. demux until the video thread displays the new frame
+    int serial; //increased by each seek. see AVThread::flush()
 };
 
 } //namespace QtAV
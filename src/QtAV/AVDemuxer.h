@@ -23,6 +23,7 @@
 #define QAV_DEMUXER_H
 
 #include <QtAV/QtAV_Global.h>
+#include <QtCore/QList>
 #include <QtCore/QObject>
 #include <QtCore/QSize>
 #include <QtCore/QMutex>
@@ -43,17 +44,41 @@ struct AVStream;
 namespace QtAV {
 
 class AVClock;
+class KeyFrameIndex;
+class MappedIO;
 class Packet;
+class ReadAheadIO;
 class Q_EXPORT AVDemuxer : public QObject //QIODevice?
 {
     Q_OBJECT
 public:
+    enum SeekType {
+        KeyFrameSeek, //seek to the nearest key frame
+        AccurateSeek //seek to the key frame before the position. the decoders discard the data before the position
+    };
+    //emitted by loadProgress()
+    enum LoadStage {
+        OpeningInput, //avformat_open_input()
+        FindingStreamInfo, //avformat_find_stream_info() or the stream info cache
+        OpeningCodecs
+    };
+
     AVDemuxer(const QString& fileName = QString(), QObject *parent = 0);
     ~AVDemuxer();
 
     bool atEnd() const;
     bool close();
+    //blocks until the file is opened and probed. DO NOT call it when loading asynchronously
     bool loadFile(const QString& fileName);
+    /*
+     * Open and probe the file in a worker thread and return immediately. loadFinished() is emitted in this object's
+     * thread when done. If a file is being loaded, it's cancelled and fileName is loaded after it stops, only the
+     * last one is reported. The demuxer must not be used until loadFinished()
+     */
+    void loadFileAsync(const QString& fileName);
+    //interrupt the asynchronous loading. loadFinished(false) is emitted
+    void cancelLoad();
+    bool isLoading() const;
     bool readFrame();
     Packet* packet() const; //current readed packet
     int stream() const; //current readed stream index
@@ -64,6 +89,65 @@ public:
     //seek default steps
     void seekForward();
     void seekBackward();
+    void setSeekType(SeekType type);
+    SeekType seekType() const;
+    //the position in seconds requested by the last seek. -1 if it's not seeked, e.g. invalid position
+    //if the key frame index is used for KeyFrameSeek, it's the position of the key frame
+    qreal seekTarget() const;
+    /*
+     * Build a key frame index(pts -> byte position) in a low priority thread when a local file is loaded.
+     * Seeking jumps to the byte position of the key frame if it's indexed and the format supports seeking
+     * by byte. It's faster and more precise for formats without index, e.g. MPEG-TS. KeyFrameSeek uses the
+     * nearest key frame, AccurateSeek uses the one before the position. The index is saved as
+     * fileName.qtavidx and loaded by the next loadFile(). Takes effect for the next loadFile(). default is false
+     */
+    void setKeyFrameIndexEnabled(bool enabled);
+    bool isKeyFrameIndexEnabled() const;
+    /*
+     * Fast open profile: probe less data in loadFile() for quick switching between files. The limits not set
+     * by the setters below are 64KB, 0.5s and 3 frames. Some stream info, e.g. the frame rate or the
+     * duration of some formats, may be less accurate. default is false
+     */
+    void setFastOpen(bool fast);
+    bool isFastOpen() const;
+    //bytes read to detect the format and the streams. <=0: the profile's default
+    void setProbeSize(int bytes);
+    int probeSize() const;
+    //usecs of data analyzed to find the stream info. <=0: the profile's default
+    void setAnalyzeDuration(qint64 us);
+    qint64 analyzeDuration() const;
+    //frames used to detect the frame rate. <=0: the profile's default
+    void setFpsProbeSize(int frames);
+    int fpsProbeSize() const;
+    /*
+     * Save the stream info found for local files, and use it instead of avformat_find_stream_info() when the
+     * same file(path, size and modified time) is loaded again. default is false
+     */
+    void setStreamInfoCacheEnabled(bool enabled);
+    bool isStreamInfoCacheEnabled() const;
+    //the last loadFile() used the cached stream info
+    bool isStreamInfoCached() const;
+    /*
+     * Read local files from a memory mapped region instead of read() calls, see MappedIO. If the file can not be
+     * mapped, FFmpeg's file protocol is used. Takes effect for the next loadFile(). default is true
+     */
+    void setMemoryMapEnabled(bool enabled);
+    bool isMemoryMapEnabled() const;
+    /*
+     * Read the input in an I/O thread into a ring of bytes ahead of the demuxer, see ReadAheadIO. A storage or
+     * network stall does not stall demuxing until the buffered data is used up. 8MB~64MB is recommended.
+     * It's used instead of the memory map. Takes effect for the next loadFile(). 0: disabled(default)
+     */
+    void setReadAheadSize(int bytes);
+    int readAheadSize() const;
+    //statistics of the read-ahead buffer since the last loadFile(). 0 if not used
+    int readAheadSeekHits() const; //seeks served by the buffer
+    int readAheadSeekMisses() const; //seeks performed by the protocol
+    int readAheadStalls() const; //reads waited for the I/O thread
+    //msecs spent by the last loadFile(). avformat_open_input(), finding the stream info and the whole
+    qint64 openInputTime() const;
+    qint64 streamInfoTime() const;
+    qint64 loadTime() const;
 
     //format
     AVFormatContext* formatContext();
@@ -82,6 +166,21 @@ public:
     int audioStream() const;
     int videoStream() const;
     int subtitleStream() const;
+    //indexes of all the streams of the type
+    QList<int> audioStreams() const;
+    QList<int> videoStreams() const;
+    QList<int> subtitleStreams() const;
+    /*
+     * Select the audio stream. index: one of audioStreams(). -1: the best one, e.g. in the same program as the
+     * video stream(default). If no file is loaded, it's used by the following loadFile() if it's an audio stream
+     * of that file. Otherwise it's for the loaded file only and is reset when the file is closed.
+     * If a file is loaded, the new stream's codec is opened and the old one is closed without reopening the file,
+     * the caller must make sure the audio decoder does not use the old one, see AVDemuxThread::setAudioStream().
+     * The streams not selected are discarded(AVStream::discard), the demuxer does not read them into packets.
+     */
+    bool setAudioStream(int index);
+    //select the video stream for the following loadFile(). -1: the best one(default)
+    void setVideoStream(int index);
 
     int width() const; //AVCodecContext::width;
     int height() const; //AVCodecContext::height
@@ -125,16 +224,31 @@ signals:
     /*emit when the first frame is read*/
     void started();
     void finished(); //end of file
+    //stage: LoadStage. emitted in the loading thread
+    void loadProgress(int stage);
+    void loadFinished(bool ok); //loadFileAsync()
+
+private slots:
+    void onLoadThreadFinished();
 
 private:
+    class LoadThread;
+    bool load(const QString& fileName); //loadFile() without resetting the interrupt status
+
     bool started_;
     bool eof;
     Packet *pkt;
     qint64 ipts;
     int stream_idx;
     mutable int audio_stream, video_stream, subtitle_stream;
+    int wanted_audio_stream, wanted_video_stream; //setAudioStream(), setVideoStream()
 
     bool findAVCodec();
+    //wanted: the selected index or -1. related: the stream the result should be in the same program with
+    int findStream(int type, int wanted, int related) const;
+    QList<int> streams(int type) const;
+    //AVDISCARD_ALL for the streams and programs not selected
+    void discardUnusedStreams();
     QString formatName(AVFormatContext *ctx, bool longName = false) const;
 
     bool _is_input;
@@ -144,7 +258,22 @@ private:
     QString _file_name;
     QMutex mutex; //for seek and readFrame
 	AVClock *master_clock;
-    QElapsedTimer seek_timer;
+    SeekType seek_type;
+    qreal seek_target;
+    bool index_enabled;
+    KeyFrameIndex *key_index;
+    bool fast_open, cache_info, info_cached;
+    int probe_size, fps_probe_size;
+    qint64 analyze_duration;
+    qint64 open_time, info_time, load_time; //msecs
+    LoadThread *load_thread;
+    bool mmap_enabled;
+    MappedIO *mapped_io; //AVFormatContext.pb if the file is mapped
+    int read_ahead_size;
+    ReadAheadIO *read_ahead_io; //AVFormatContext.pb if reading ahead
+    bool loading; //between loadFileAsync() and loadFinished(). accessed in this object's thread only
+    QString load_request; //the file to load when the loading thread finishes
+    bool load_ok; //the result of the loading thread
 
     /**
      * interrupt callback for ffmpeg
@@ -159,7 +288,7 @@ private:
     qint64 __interrupt_timeout;
 
     //interrupt status
-    int __interrupt_status;
+    volatile int __interrupt_status;
 
 };
 
@@ -49,6 +49,14 @@ public:
 	QString file() const;
     bool load(const QString& path);
     bool load();
+    /*
+     * Open and probe the file in a worker thread and return immediately, the calling thread is not blocked by I/O.
+     * loadProgress() and loadFinished() are emitted. A new request cancels the one being loaded. play() when
+     * loading plays the file if it's loaded successfully
+     */
+    void loadAsync(const QString& path);
+    void loadAsync();
+    bool isLoading() const;
     bool isLoaded() const;
     /*
      * default: [fmt: PNG, dir: capture, name: basename]
@@ -67,20 +75,81 @@ public:
     VideoRenderer* setRenderer(VideoRenderer* renderer);
     VideoRenderer* renderer();
     AudioOutput* audio();
+    /*
+     * The audio output is opened once with this format and kept open for all files. The audio is resampled and
+     * remixed to it. 0: use the first file's sample rate or channels. Takes effect in the next load()
+     */
+    void setAudioOutputFormat(int sampleRate, int channels);
     void setMute(bool mute);
     bool isMute() const;
+    /*
+     * Playback speed in [0.25, 4]. 1.0 is normal. Audio is time-stretched, the pitch is not changed. Video drops
+     * late frames if faster than normal and decodes reference frames only if faster than 2x
+     */
+    void setSpeed(qreal speed);
+    qreal speed() const;
+    /*
+     * Limit the packet queues by payload bytes and buffered duration(seconds) besides the packet count.
+     * Demuxing stops when a queue reaches high and continues when it is below low. high <= 0: no limit.
+     * low < 0: high/2. e.g. setBufferDuration(2.0) for a stable network stream
+     */
+    void setBufferBytes(int high, int low = -1);
+    void setBufferDuration(qreal high, qreal low = -1);
+    //video frames not displayed or decoded because video is late. see VideoThread
+    int droppedVideoFrames() const;
+    int skippedVideoFrames() const;
+    //A/V sync error in seconds, see VideoThread::syncError()
+    qreal videoSyncError() const;
+    /*
+     * AVDemuxer::AccurateSeek: the first frame displayed after seeking is the frame at the requested position.
+     * the frames from the key frame before it are decoded but not displayed. default is AVDemuxer::KeyFrameSeek
+     */
+    void setSeekType(AVDemuxer::SeekType type);
+    AVDemuxer::SeekType seekType() const;
+    //threads converting a video frame. see VideoDecoder::setConvertThreads(). 0: auto(default)
+    void setVideoConvertThreads(int threads);
+    int videoConvertThreads() const;
+    //see AVDemuxer::setKeyFrameIndexEnabled(). takes effect for the next file loaded. default is false
+    void setKeyFrameIndexEnabled(bool enabled);
+    bool isKeyFrameIndexEnabled() const;
+    //AVDemuxer's fast open profile and stream info cache, for quick switching between files. default is false
+    void setFastOpen(bool fast);
+    bool isFastOpen() const;
+    //see AVDemuxer::setReadAheadSize(). takes effect for the next file loaded. 0: disabled(default)
+    void setReadAheadSize(int bytes);
+    int readAheadSize() const;
+    //stream indexes of the loaded file. see AVDemuxer::audioStreams()
+    QList<int> audioStreams() const;
+    int audioStream() const;
+    //switch the audio track without reloading. see AVDemuxThread::setAudioStream()
+    bool setAudioStream(int index);
+    //msecs spent by loading the last file. see AVDemuxer::loadTime()
+    qint64 loadTime() const;
+    //msecs from the last seek performed to the first frame(audio if no video) output. -1 if not finished
+    qint64 seekLatency() const;
     /*only 1 event filter is available. the previous one will be removed. setPlayerEventFilter(0) will remove the event filter*/
     void setPlayerEventFilter(QObject *obj);
 
 signals:
     void started();
     void stopped();
+    //the last seek is performed. pos: the position in seconds playing continues from
+    void seekFinished(qreal pos);
+    //loadAsync(). stage: AVDemuxer::LoadStage
+    void loadProgress(int stage);
+    void loadFinished(bool ok);
 
 public slots:
     void pause(bool p);
     void play(); //replay
     void stop();
+    //cancel loadAsync(). loadFinished(false) is emitted
+    void cancelLoad();
     void playNextFrame();
+    /*
+     * seek functions return immediately. the seek is done in the demuxing thread and a new request
+     * replaces the one not performed yet. seekFinished() is emitted when done
+     */
     void seek(qreal pos);
     void seekForward();
     void seekBackward();
@@ -88,11 +157,18 @@ public slots:
 
 protected slots:
     void resizeRenderer(const QSize& size);
+    void onLoadFinished(bool ok);
 
 protected:
+    //setup the decoders and the output for the file loaded by the demuxer
+    void setupLoaded();
+    //start the threads. the file is loaded and at the beginning
+    void playLoaded();
+
     bool loaded;
+    bool play_on_load; //play() is called when loading asynchronously
     AVFormatContext	*formatCtx; //changed when reading a packet
-    AVCodecContext *aCodecCtx, *vCodecCtx; //set once and not change
+    AVCodecContext *aCodecCtx, *vCodecCtx; //set when loaded. aCodecCtx is changed by setAudioStream()
     QString path;
     QString capture_name, capture_dir;
 
@@ -102,6 +178,8 @@ protected:
     AVClock *clock;
     VideoRenderer *_renderer; //list?
     AudioOutput *_audio;
+    int ao_sample_rate, ao_channels; //requested by user. 0: the first file's
+    int ao_opened_rate, ao_opened_channels; //requested when the output is opened
     AudioDecoder *audio_dec;
     VideoDecoder *video_dec;
     AudioThread *audio_thread;
@@ -53,6 +53,22 @@ public:
     AVOutput* output() const;
 
     void setDemuxEnded(bool ended);
+    //clear the packets and the data decoded ahead. called when seeking
+    virtual void clearBuffers();
+    /*
+     * Called after seeking. Clear the buffers and put a flush packet whose pts is target. serial is the new seek
+     * serial and the packets put later must carry it. The packets and the decoded data of an older serial are
+     * dropped, and the decoder is flushed once per serial. target >= 0: accurate seek, the data earlier than
+     * target is decoded but not output
+     */
+    void flush(int serial, qreal target = -1);
+    /*
+     * Accept the packets of serial without flushing when the thread is restarted, e.g. with another audio
+     * stream. Call it before start(), otherwise a new session starts from serial 0 as AVDemuxThread does
+     */
+    void setSerial(int serial);
+    //msecs from the last flush() to the first data output. -1 if not finished
+    qint64 seekLatency() const;
 
     bool isPaused() const;
 public slots:
@@ -63,6 +79,14 @@ public slots:
 protected:
     AVThread(AVThreadPrivate& d, QObject *parent = 0);
     void resetState();
+    //the first data after flush() is output. records the latency
+    void finishSeek();
+    /*
+     * Wait until the clock reaches pts, but not longer than the current delay. The wait is split into short slices
+     * and the delay is recomputed, so a clock jump, e.g. the clock is updated after seeking, a newer serial than
+     * serial or stop() ends it. Returns the delay left
+     */
+    qreal waitForClock(qreal pts, int serial);
     /*
      * If the pause state is true setted by pause(true), then block the thread and wait for pause state changed, i.e. pause(false)
      * and return true. Otherwise, return false immediatly.
@@ -33,6 +33,7 @@ class Q_EXPORT AudioDecoder : public AVDecoder
 public:
     AudioDecoder();
     virtual bool decode(const QByteArray &encoded);
+    virtual bool decode(const Packet& packet);
 };
 
 } //namespace QtAV
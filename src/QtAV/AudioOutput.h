@@ -34,6 +34,10 @@ public:
     AudioOutput();
     virtual ~AudioOutput() = 0;
 
+    /*
+     * The device format. Set them before open(). The device may support less channels, then channels()
+     * is changed by open(). AudioThread resamples and remixes the decoded audio to this format
+     */
     void setSampleRate(int rate);
     int sampleRate() const;
 
@@ -44,6 +48,12 @@ public:
     qreal volume() const;
     void setMute(bool yes);
     bool isMute() const;
+    //open() succeeded and close() is not called. an opened output can be used for more than 1 file
+    bool isOpen() const;
+    //seconds of the written samples not played yet, i.e. buffered and the device latency. used by the audio clock
+    virtual qreal latency() const;
+    //drop the written samples not played yet, e.g. after seeking or stopping. does nothing by default
+    virtual void clear();
 
 protected:
     AudioOutput(AudioOutputPrivate& d);
@@ -35,6 +35,7 @@ class BlockingQueue
 {
 public:
     BlockingQueue();
+    virtual ~BlockingQueue() {}
 
     void setCapacity(int max); //enqueue is allowed if less than capacity
     void setThreshold(int min); //wake up and enqueue
@@ -50,6 +51,18 @@ public:
     inline int size() const;
     inline int threshold() const;
     inline int capacity() const;
+    //true if the consumer has enough elements and the producer can wait
+    inline bool isEnough() const;
+
+protected:
+    /*
+     * Reimplement them to limit the queue by something else. They are called with the lock held.
+     * onTake() is called for every element removed by take() or clear()
+     */
+    virtual bool checkFull() const;
+    virtual bool checkEnough() const;
+    virtual void onPut(const T& t) { Q_UNUSED(t); }
+    virtual void onTake(const T& t) { Q_UNUSED(t); }
 
 private:
     bool block_empty, block_full;
@@ -87,9 +100,10 @@ void BlockingQueue<T, Container>::put(const T& t)
 {
     QWriteLocker locker(&lock);
     Q_UNUSED(locker);
-    if (block_full && queue.size() >= cap)
+    if (block_full && checkFull())
         cond_full.wait(&lock);
     queue.enqueue(t);
+    onPut(t);
     cond_empty.wakeAll();
 }
 
@@ -98,7 +112,7 @@ T BlockingQueue<T, Container>::take()
 {
     QWriteLocker locker(&lock);
     Q_UNUSED(locker);
-    if (queue.size() < thres)
+    if (!checkEnough())
         cond_full.wakeAll();
     if (block_empty && queue.isEmpty())//TODO:always block?
         cond_empty.wait(&lock);
@@ -107,7 +121,9 @@ T BlockingQueue<T, Container>::take()
         qWarning("Queue is still empty");
         return T();
     }
-    return queue.dequeue();
+    T t(queue.dequeue());
+    onTake(t);
+    return t;
 }
 
 template <typename T, template <typename> class Container>
@@ -151,7 +167,8 @@ void BlockingQueue<T, Container>::clear()
     //cond_empty.wakeAll();
     cond_full.wakeAll();
     Q_UNUSED(locker);
-    queue.clear();
+    while (!queue.isEmpty())
+        onTake(queue.dequeue());
     //TODO: assert not empty
 }
 
@@ -183,5 +200,24 @@ int BlockingQueue<T, Container>::capacity() const
     return cap;
 }
 
+template <typename T, template <typename> class Container>
+bool BlockingQueue<T, Container>::isEnough() const
+{
+    QReadLocker locker(&lock);
+    return checkEnough();
+}
+
+template <typename T, template <typename> class Container>
+bool BlockingQueue<T, Container>::checkFull() const
+{
+    return queue.size() >= cap;
+}
+
+template <typename T, template <typename> class Container>
+bool BlockingQueue<T, Container>::checkEnough() const
+{
+    return queue.size() >= thres;
+}
+
 } //namespace QtAV
 #endif // QTAV_BLOCKINGQUEUE_H
@@ -0,0 +1,316 @@
+/******************************************************************************
+    QtAV:  Media play library based on Qt and FFmpeg
+    Copyright (C) 2012-2013 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+
+
+#ifndef QTAV_BLOCKINGRING_H
+#define QTAV_BLOCKINGRING_H
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+#include <QtCore/QWaitCondition>
+
+/*
+ * Bounded single producer/single consumer ring with the same api as BlockingQueue.
+ * put() and take() do not lock if the ring is neither empty nor full. The mutex and wait conditions are
+ * used only when a thread has to sleep, and the other side wakes it only if it's really waiting.
+ * clear() can be called in any thread. It's serialized with take() by a consumer token which is held only
+ * while an element is being moved out, so it never waits for a sleeping consumer.
+ * capacity is where put() starts to block, the storage is twice of the capacity so that put() still
+ * works if blockFull(false). put() always waits if the storage is full unless setBlocking(false).
+ */
+namespace QtAV {
+
+template <typename T>
+class BlockingRing
+{
+public:
+    BlockingRing();
+    virtual ~BlockingRing() {}
+
+    //storage is reallocated only when the ring is empty, i.e. before producing
+    void setCapacity(int max); //enqueue is allowed if less than capacity
+    void setThreshold(int min); //wake up and enqueue
+
+    void put(const T& t);
+    T take();
+    void setBlocking(bool block); //will wake if false. called when no more data can enqueue
+    void blockEmpty(bool block);
+    void blockFull(bool block);
+    inline void clear();
+    inline bool isEmpty() const;
+    inline int size() const;
+    inline int threshold() const;
+    inline int capacity() const;
+    //true if the consumer has enough elements and the producer can wait
+    inline bool isEnough() const;
+
+protected:
+    /*
+     * Reimplement them to limit the ring by something else. checkFull() is called in producer thread,
+     * checkEnough() in consumer thread. onPut() is called in producer thread before the element is visible
+     * to the consumer. onTake() is called for every element removed by take() or clear().
+     */
+    virtual bool checkFull() const;
+    virtual bool checkEnough() const;
+    virtual void onPut(const T& t) { Q_UNUSED(t); }
+    virtual void onTake(const T& t) { Q_UNUSED(t); }
+
+private:
+    //QAtomicInt api changes in Qt5. ordered read-modify-write works for both and is a full barrier
+    static inline int load(const QAtomicInt& a) { return const_cast<QAtomicInt&>(a).fetchAndAddOrdered(0); }
+    static inline void store(QAtomicInt& a, int v) { a.fetchAndStoreOrdered(v); }
+    //counters are free running. the difference is correct even if they overflow
+    static inline int distance(int from, int to) { return int(uint(to) - uint(from)); }
+    void lockConsumer();
+    inline void unlockConsumer() { store(consumer, 0); }
+    bool shouldWait() const;
+    void wakeFull();
+
+    volatile bool block_empty, block_full;
+    int cap, thres; //static?
+    QVector<T> ring;
+    int mask;
+    QAtomicInt in, out; //in: producer only, out: consumer token owner only
+    QAtomicInt consumer; //consumer token. only contended by clear()
+    QAtomicInt waiting_empty, waiting_full;
+    QMutex mutex; //only for sleeping
+    QWaitCondition cond_full, cond_empty;
+};
+
+
+template <typename T>
+BlockingRing<T>::BlockingRing()
+    :block_empty(true),block_full(true),cap(0),thres(128),mask(0)
+    ,in(0),out(0),consumer(0),waiting_empty(0),waiting_full(0)
+{
+    setCapacity(128*3);
+}
+
+template <typename T>
+void BlockingRing<T>::setCapacity(int max)
+{
+    lockConsumer();
+    cap = qMax(max, 1);
+    int n = 2;
+    while (n < 2*cap)
+        n <<= 1;
+    if (n > ring.size() && load(in) == load(out)) {
+        ring = QVector<T>(n);
+        mask = n - 1;
+        store(in, 0);
+        store(out, 0);
+    } else if (n > ring.size()) {
+        qWarning("BlockingRing is not empty. capacity is limited by the storage size %d", ring.size());
+    }
+    unlockConsumer();
+    wakeFull();
+}
+
+template <typename T>
+void BlockingRing<T>::setThreshold(int min)
+{
+    thres = min;
+}
+
+template <typename T>
+void BlockingRing<T>::put(const T& t)
+{
+    for (;;) {
+        const int i = load(in);
+        const int used = distance(load(out), i);
+        if (used < ring.size() && !(block_full && checkFull())) {
+            ring[i & mask] = t;
+            onPut(t);
+            store(in, i + 1);
+            if (load(waiting_empty)) {
+                QMutexLocker locker(&mutex);
+                Q_UNUSED(locker);
+                cond_empty.wakeOne();
+            }
+            return;
+        }
+        if (used >= ring.size() && !block_full && !block_empty) {
+            qWarning("BlockingRing is full and not blocking. drop the element");
+            return;
+        }
+        QMutexLocker locker(&mutex);
+        Q_UNUSED(locker);
+        store(waiting_full, 1);
+        //check again. take() may be done before waiting_full is set
+        if (shouldWait())
+            cond_full.wait(&mutex);
+        store(waiting_full, 0);
+    }
+}
+
+template <typename T>
+T BlockingRing<T>::take()
+{
+    for (;;) {
+        lockConsumer();
+        const int o = load(out);
+        if (o != load(in)) {
+            T t = ring[o & mask];
+            ring[o & mask] = T(); //release the reference now
+            onTake(t);
+            store(out, o + 1);
+            unlockConsumer();
+            if (load(waiting_full) && !checkEnough())
+                wakeFull();
+            return t;
+        }
+        unlockConsumer();
+        if (!block_empty)
+            break;
+        QMutexLocker locker(&mutex);
+        Q_UNUSED(locker);
+        store(waiting_empty, 1);
+        //check again. put() may be done before waiting_empty is set
+        if (block_empty && load(in) == load(out))
+            cond_empty.wait(&mutex);
+        store(waiting_empty, 0);
+    }
+    return T();
+}
+
+template <typename T>
+void BlockingRing<T>::setBlocking(bool block)
+{
+    QMutexLocker locker(&mutex);
+    Q_UNUSED(locker);
+    block_empty = block_full = block;
+    if (!block) {
+        cond_empty.wakeAll(); //empty still wait. setBlock=>setCapacity(-1)
+        cond_full.wakeAll();
+    }
+}
+
+template <typename T>
+void BlockingRing<T>::blockEmpty(bool block)
+{
+    if (block_empty == block)
+        return;
+    QMutexLocker locker(&mutex);
+    Q_UNUSED(locker);
+    block_empty = block;
+    if (!block) {
+        cond_empty.wakeAll();
+    }
+}
+
+template <typename T>
+void BlockingRing<T>::blockFull(bool block)
+{
+    if (block_full == block)
+        return;
+    QMutexLocker locker(&mutex);
+    Q_UNUSED(locker);
+    block_full = block;
+    if (!block) {
+        cond_full.wakeAll();
+    }
+}
+
+template <typename T>
+void BlockingRing<T>::clear()
+{
+    lockConsumer();
+    const int i = load(in);
+    for (int o = load(out); o != i; ++o) {
+        onTake(ring[o & mask]);
+        ring[o & mask] = T();
+    }
+    store(out, i);
+    unlockConsumer();
+    wakeFull();
+}
+
+template <typename T>
+bool BlockingRing<T>::isEmpty() const
+{
+    return load(in) == load(out);
+}
+
+template <typename T>
+int BlockingRing<T>::size() const
+{
+    return qMax(distance(load(out), load(in)), 0);
+}
+
+template <typename T>
+int BlockingRing<T>::threshold() const
+{
+    return thres;
+}
+
+template <typename T>
+int BlockingRing<T>::capacity() const
+{
+    return cap;
+}
+
+template <typename T>
+bool BlockingRing<T>::isEnough() const
+{
+    return checkEnough();
+}
+
+template <typename T>
+bool BlockingRing<T>::checkFull() const
+{
+    return size() >= cap;
+}
+
+template <typename T>
+bool BlockingRing<T>::checkEnough() const
+{
+    return size() >= thres;
+}
+
+template <typename T>
+void BlockingRing<T>::lockConsumer()
+{
+    //only contended by clear(), which holds it for a very short time
+    while (!consumer.testAndSetOrdered(0, 1))
+        QThread::yieldCurrentThread();
+}
+
+template <typename T>
+bool BlockingRing<T>::shouldWait() const
+{
+    if (distance(load(out), load(in)) >= ring.size())
+        return block_full || block_empty;
+    return block_full && checkFull();
+}
+
+template <typename T>
+void BlockingRing<T>::wakeFull()
+{
+    QMutexLocker locker(&mutex);
+    Q_UNUSED(locker);
+    cond_full.wakeAll();
+}
+
+} //namespace QtAV
+#endif // QTAV_BLOCKINGRING_H
@@ -50,6 +50,8 @@ protected:
     GraphicsItemRenderer(GraphicsItemRendererPrivate& d, QGraphicsItem *parent);
 
     virtual bool write();
+    //the repaint event posted by write()
+    virtual void customEvent(QEvent *event);
 #if CONFIG_GRAPHICSWIDGET
     virtual bool event(QEvent *event);
 #else
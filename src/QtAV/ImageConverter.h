@@ -48,12 +48,30 @@ public:
     void setOutFormat(int format);
     void setInterlaced(bool interlaced);
     bool isInterlaced() const;
-    virtual bool convert(const quint8 *const srcSlice[], const int srcStride[]) = 0;
+    /*
+     * threads used by convert() if the implementation supports. 0: QThread::idealThreadCount(), the default.
+     * The result does not depend on the thread count
+     */
+    void setThreads(int threads);
+    int threads() const;
+    /*
+     * Convert to outData(), which is allocated by the converter. A new buffer is allocated if the last one
+     * is still referenced by others, so the consumer's data is never overwritten.
+     */
+    bool convert(const quint8 *const srcSlice[], const int srcStride[]);
+    /*
+     * Convert to the planes owned by the caller, e.g. a pooled frame or a renderer's back buffer. The picture
+     * is written once and nothing is copied. The out size must be set and dst must be large enough.
+     * Planes and strides aligned to 64 bytes(see outLineSize()) are the fastest for SIMD.
+     */
+    virtual bool convert(const quint8 *const srcSlice[], const int srcStride[], quint8 *const dst[], const int dstStride[]) = 0;
+    //bytes per line of the out plane with the alignment
+    int outLineSize(int plane, int align = 64) const;
     //virtual bool convertColor(const quint8 *const srcSlice[], const int srcStride[]) = 0;
     //virtual bool resize(const quint8 *const srcSlice[], const int srcStride[]) = 0;
 protected:
     ImageConverter(ImageConverterPrivate& d);
-    //Allocate memory for out data. Called in setOutFormat()
+    //Allocate memory for outData(). Called by convert() if the last out data can not be reused
     virtual bool prepareData();
     DPTR_DECLARE(ImageConverter)
 };
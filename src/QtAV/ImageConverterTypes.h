@@ -38,6 +38,7 @@ namespace QtAV {
 //why can not be const for msvc?
 extern ImageConverterId ImageConverterId_FF;    //0
 extern ImageConverterId ImageConverterId_IPP;   //1
+extern ImageConverterId ImageConverterId_SIMD;  //2
 
 /*
  * This must be called manually in your program(outside this library) if your compiler does
@@ -35,6 +35,10 @@ public:
     ImageRenderer();
     virtual ~ImageRenderer();
     //virtual QImage currentFrameImage() const;
+    //frames replaced by a newer frame before they are painted, e.g. superseded while a repaint is pending
+    int overwrittenFrames() const;
+    //frames not painted because the data does not match the size
+    int droppedFrames() const;
 protected:
     virtual void convertData(const QByteArray &data);
     ImageRenderer(ImageRendererPrivate& d);
@@ -26,18 +26,49 @@
 #include <QtCore/QByteArray>
 #include <QtCore/QQueue>
 #include <QtCore/QMutex>
+#include <QtCore/QSharedData>
 #include <QtAV/BlockingQueue.h>
-//#include <QtAV/BlockingRing.h>
+#include <QtAV/BlockingRing.h>
 #include <QtAV/QtAV_Global.h>
 
+struct AVPacket;
+
 namespace QtAV {
+
+class PacketPrivate;
+/*
+ * Packet keeps a reference of the demuxed AVPacket, so copying a Packet does not copy the payload.
+ * data is a raw reference of AVPacket.data, it's valid as long as the Packet or a copy of it exists.
+ */
 class Q_EXPORT Packet
 {
 public:
+    /*
+     * Take the ownership of avpkt's payload, side data and flags. avpkt is reset and can not be used
+     * to free the data again. time_base is used to convert pts and duration to seconds
+     */
+    static Packet fromAVPacket(AVPacket* avpkt, double time_base);
+
     Packet();
+    ~Packet();
+    Packet(const Packet& other);
+    Packet& operator=(const Packet& other);
+
     inline bool isValid() const;
+    /*
+     * the demuxed packet with padding, side data and flags. 0 if the Packet is not created by fromAVPacket(),
+     * e.g. the flush packet. DO NOT modify or free it, it's shared by all copies of this Packet
+     */
+    const AVPacket* asAVPacket() const;
+    //seconds per unit of asAVPacket()'s timestamps. 0 if the Packet is not created by fromAVPacket()
+    double timeBase() const;
+
+    bool hasKeyFrame;
     QByteArray data;
     qreal pts, duration;
+    int serial; //the seek serial when demuxed. see AVThread::flush()
+private:
+    QExplicitlySharedDataPointer<PacketPrivate> d;
 };
 
 bool Packet::isValid() const
@@ -53,9 +84,53 @@ public:
 	T dequeue() { this->pop(); return this->front(); }
 	void enqueue(const T& t) { this->push(t); }
 };
-typedef BlockingQueue<Packet, QQueue> PacketQueue;
-//typedef BlockingQueue<Packet, StdQueue> PacketQueue;
-//typedef BlockingRing<Packet> PacketQueue;
+/*
+ * Each PacketQueue has only 1 producer(AVDemuxThread) and 1 consumer(AVThread), so the lock-free ring is used
+ * by default. Define CONFIG_PACKETQUEUE_RING to 0 to use the locked queue
+ */
+#ifndef CONFIG_PACKETQUEUE_RING
+#define CONFIG_PACKETQUEUE_RING 1
+#endif //CONFIG_PACKETQUEUE_RING
+#if CONFIG_PACKETQUEUE_RING
+typedef BlockingRing<Packet> PacketQueueBase;
+#else
+typedef BlockingQueue<Packet, QQueue> PacketQueueBase;
+//typedef BlockingQueue<Packet, StdQueue> PacketQueueBase;
+#endif //CONFIG_PACKETQUEUE_RING
+
+/*
+ * Besides the packet count(capacity and threshold), the queue can be limited by payload bytes and by the
+ * buffered duration, i.e. the pts distance between the last put and the last taken packet.
+ * put() blocks if any high watermark is reached. The producer is woken up when the values are below the
+ * low watermarks and the packet count is below threshold.
+ */
+class Q_EXPORT PacketQueue : public PacketQueueBase
+{
+public:
+    PacketQueue();
+    //high <= 0: no limit. low < 0: high/2
+    void setBytesLimit(int high, int low = -1);
+    int bytesLimit() const;
+    //in seconds. high <= 0: no limit. low < 0: high/2
+    void setDurationLimit(qreal high, qreal low = -1);
+    qreal durationLimit() const;
+    int bytes() const;
+    qreal bufferedDuration() const; //in seconds
+
+protected:
+    virtual bool checkFull() const;
+    virtual bool checkEnough() const;
+    virtual void onPut(const Packet& packet);
+    virtual void onTake(const Packet& packet);
+
+private:
+    //pts distance from last packet in us. put and take see the same sequence, so the sums cancel out exactly
+    static int ptsDelta(qreal *last, const Packet& packet);
+    volatile int bytes_high, bytes_low;
+    volatile int duration_high, duration_low; //us
+    QAtomicInt bytes_buffered, duration_buffered; //us
+    qreal put_pts, take_pts; //owned by producer and consumer
+};
 } //namespace QtAV
 
 #endif // QAV_PACKET_H
@@ -33,6 +33,7 @@ extern "C"
 #include <libavutil/avutil.h>
 #include <libavutil/error.h>
 #include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
 #ifdef __cplusplus
 }
 #endif /*__cplusplus*/
@@ -123,4 +124,8 @@ av_always_inline char* av_err2str(int errnum)
 #define av_dump_format(...) dump_format(__VA_ARGS__)
 #endif
 
+#if (LIBAVUTIL_VERSION_INT < AV_VERSION_INT(52,3,0))
+#define av_pix_fmt_desc_get(pix_fmt) (&av_pix_fmt_descriptors[pix_fmt])
+#endif
+
 #endif
@@ -32,14 +32,43 @@ class Q_EXPORT VideoDecoder : public AVDecoder
 {
     DPTR_DECLARE_PRIVATE(VideoDecoder)
 public:
+    /*
+     * Decode less to catch up with the clock.
+     * HurryNonRef: skip non-reference frames and the loop filter. HurryKeyFrame: decode key frames only
+     */
+    enum HurryUp {
+        HurryNone,
+        HurryNonRef,
+        HurryKeyFrame,
+        HurrySkipNonRef //skip non-reference frames only. the reference frames are exact, e.g. decoding to a seek target
+    };
+
     VideoDecoder();
+    void setHurryUp(HurryUp mode);
+    HurryUp hurryUp() const;
+    //if false, the decoded frame is not converted and data() is empty. default is true
+    void setConvertEnabled(bool enabled);
+    bool isConvertEnabled() const;
+    /*
+     * Convert the last decoded frame into the planes owned by the caller, e.g. a pooled buffer.
+     * Use it with setConvertEnabled(false) so that the frame is not converted twice.
+     */
+    bool convertTo(quint8 *const dst[], const int dstStride[]);
+    //threads converting a frame. see ImageConverter::setThreads(). 0: QThread::idealThreadCount(), the default
+    void setConvertThreads(int threads);
+    int convertThreads() const;
     virtual bool decode(const QByteArray &encoded);
+    virtual bool decode(const Packet& packet);
+    //the last decode() consumed the packet without error but output no frame, e.g. skipped by setHurryUp() or delayed
+    bool isFrameSkipped() const;
 
     void resizeVideoFrame(const QSize& size);
     void resizeVideoFrame(int width, int height);
 
     int width() const;
     int height() const;
+    //the presentation timestamp of the last decoded frame in seconds. may differ from the packet's if reordered. <0: unknown
+    qreal framePts() const;
 };
 
 } //namespace QtAV
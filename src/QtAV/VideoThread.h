@@ -37,13 +37,36 @@ class VideoThread : public AVThread
     DPTR_DECLARE_PRIVATE(VideoThread)
 public:
     explicit VideoThread(QObject *parent = 0);
+    /*
+     * Frames are decoded and converted ahead of the clock in a decoding thread, at most frames or
+     * bytes(<=0: no limit) of them. This thread only waits for the clock and writes them to the renderer.
+     * It takes effect in the next play.
+     */
+    void setDecodeAhead(int frames, int bytes = 0);
+    int decodeAheadFrames() const;
+    /*
+     * If video is late, drop late frames, skip converting, skip non-reference frames and finally decode
+     * key frames only. The level goes back when video catches up. Enabled by default
+     */
+    void setHurryUpEnabled(bool enabled);
+    bool isHurryUpEnabled() const;
+    int hurryUpLevel() const; //0: normal
+    int droppedFrames() const; //decoded but not displayed because late. reset when play
+    int skippedFrames() const; //packets whose frames are discarded by the decoder in hurry up mode. reset when play
+    qreal syncError() const; //moving average of |pts - clock| in seconds when frames are displayed
     //return the old
     ImageConverter* setImageConverter(ImageConverter *converter);
     ImageConverter* imageConverter() const;
     double currentPts() const;
     VideoCapture *setVideoCapture(VideoCapture* cap); //ensure thread safe
+    virtual void clearBuffers();
+public slots:
+    virtual void stop();
 protected:
     virtual void run();
+private:
+    friend class VideoDecodeThread;
+    void decodeLoop(); //run in decoding thread
 };
 
 } //namespace QtAV
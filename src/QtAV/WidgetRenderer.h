@@ -45,6 +45,8 @@ protected:
     virtual void mouseMoveEvent(QMouseEvent *);
     virtual void mouseDoubleClickEvent(QMouseEvent *);
     virtual void paintEvent(QPaintEvent *);
+    //the repaint event posted by write()
+    virtual void customEvent(QEvent *);
     virtual bool write();
 protected:
     WidgetRenderer(WidgetRendererPrivate& d, QWidget *parent, Qt::WindowFlags f);
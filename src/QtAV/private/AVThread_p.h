@@ -41,7 +41,7 @@ class Q_EXPORT AVThreadPrivate : public DPtrPrivate<AVThread>
 {
 public:
     AVThreadPrivate():paused(false),demux_end(false),stop(false),clock(0)
-      ,dec(0),writer(0),delay(0) {
+      ,dec(0),writer(0),delay(0),serial(0),keep_serial(false),decoder_serial(0),seek_target(-1),seek_time(0),seek_latency(-1) {
     }
     //DO NOT delete dec and writer. We do not own them
     virtual ~AVThreadPrivate() {}
@@ -56,6 +56,12 @@ public:
     QMutex mutex;
     QWaitCondition cond; //pause
     qreal delay;
+    volatile int serial; //set by the last flush(). the packets and the data decoded from them of other serials are stale
+    bool keep_serial; //set by setSerial() before start(). otherwise the thread starts from serial 0
+    int decoder_serial; //the serial the decoder is flushed for. owned by the decoding thread
+    qreal seek_target; //accurate seek: the decoded data earlier than it is discarded. <0: none. set by the flush packet
+    qint64 seek_time; //when flush() is called. msecs
+    volatile qint64 seek_latency; //msecs from flush() to the first output. <0: not finished
 };
 
 } //namespace QtAV
@@ -30,12 +30,13 @@ namespace QtAV {
 class Q_EXPORT AudioOutputPrivate : public AVOutputPrivate
 {
 public:
-    AudioOutputPrivate():mute(false),channels(2)
+    AudioOutputPrivate():mute(false),opened(false),channels(2)
       ,vol(1),sample_rate(44100)
     {
     }
     virtual ~AudioOutputPrivate(){}
     bool mute;
+    bool opened; //set by open() and close()
     int channels;
     qreal vol;
     int sample_rate;
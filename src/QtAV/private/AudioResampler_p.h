@@ -0,0 +1,66 @@
+/******************************************************************************
+    QtAV:  Media play library based on Qt and FFmpeg
+    Copyright (C) 2012-2013 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+
+#ifndef QTAV_AUDIORESAMPLER_P_H
+#define QTAV_AUDIORESAMPLER_P_H
+
+#include <QtAV/QtAV_Global.h>
+#include <QtCore/QByteArray>
+
+struct SwrContext;
+
+namespace QtAV {
+
+/*
+ * Resamples and remixes interleaved float samples from the stream's format to the device's format, e.g. 5.1 to
+ * stereo, 44.1kHz to 48kHz. Uses libswresample. The context is recreated only when a format changes.
+ */
+class Q_EXPORT AudioResampler
+{
+public:
+    AudioResampler();
+    ~AudioResampler();
+    //channelLayout 0: the default layout of channels
+    void setInFormat(int sampleRate, int channels, qint64 channelLayout = 0);
+    void setOutFormat(int sampleRate, int channels);
+    //the formats are the same, convert() is not required
+    bool isPassThrough() const;
+    /*
+     * in: samples of the in format. out: samples of the out format. out may have less samples than in because
+     * the resampler delays some samples. out is reused if nobody else holds it
+     */
+    bool convert(const QByteArray& in, QByteArray *out);
+    //drop the delayed samples, e.g. after seeking
+    void reset();
+
+private:
+    bool prepare();
+
+    SwrContext *context;
+    bool dirty; //the context must be recreated
+    int in_rate, in_channels;
+    qint64 in_layout;
+    int out_rate, out_channels;
+};
+
+} //namespace QtAV
+#endif // QTAV_AUDIORESAMPLER_P_H
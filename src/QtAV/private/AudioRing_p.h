@@ -0,0 +1,108 @@
+/******************************************************************************
+    QtAV:  Media play library based on Qt and FFmpeg
+    Copyright (C) 2012-2013 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+
+
+#ifndef QTAV_AUDIORING_P_H
+#define QTAV_AUDIORING_P_H
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QVector>
+#include <string.h>
+
+namespace QtAV {
+
+/*
+ * Single producer(AudioThread) single consumer(PortAudio callback) ring of interleaved floats. No lock, the
+ * callback never waits. The positions are total floats written/read, the capacity is a power of 2, so the
+ * difference is valid after the int positions overflow. Only whole frames(channels floats) are written and
+ * read, so the available floats are always whole frames and a partial read never swaps the channels even if
+ * the capacity is not a multiple of the channels, e.g. 5.1.
+ */
+class AudioRing
+{
+public:
+    AudioRing():mask(0),channels(1),read_pos(0),write_pos(0){}
+    //not thread safe. call it when the stream is stopped
+    void resize(int floats, int frameChannels) {
+        channels = qMax(frameChannels, 1);
+        int cap = 1;
+        //half of the ring holds 1 frame at least
+        while (cap < qMax(floats, 2*channels))
+            cap <<= 1;
+        buffer.resize(cap);
+        mask = cap - 1;
+        clear();
+    }
+    void clear() {
+        read_pos.fetchAndStoreOrdered(0);
+        write_pos.fetchAndStoreOrdered(0);
+    }
+    /*
+     * Producer. Drops the floats not read yet, e.g. after seeking. Safe while the consumer is reading: the space
+     * can be written again at once, so a read that overlaps the discard returns nothing
+     */
+    void discard() {
+        const int w = write_pos.fetchAndAddOrdered(0);
+        int r = read_pos.fetchAndAddOrdered(0);
+        while (!read_pos.testAndSetOrdered(r, w))
+            r = read_pos.fetchAndAddOrdered(0);
+    }
+    int capacity() const { return buffer.size(); }
+    int available() const {
+        return int(unsigned(const_cast<QAtomicInt&>(write_pos).fetchAndAddOrdered(0))
+                    - unsigned(const_cast<QAtomicInt&>(read_pos).fetchAndAddOrdered(0)));
+    }
+    //producer. returns the floats written, whole frames
+    int write(const float *src, int n) {
+        n = qMin(n, capacity() - available());
+        n -= n % channels;
+        const int pos = write_pos.fetchAndAddOrdered(0) & mask;
+        const int first = qMin(n, capacity() - pos); //2 parts if wrapped
+        memcpy(buffer.data() + pos, src, first*sizeof(float));
+        memcpy(buffer.data(), src + first, (n - first)*sizeof(float));
+        write_pos.fetchAndAddOrdered(n); //publish after the data is written
+        return n;
+    }
+    //consumer. returns the floats read, whole frames
+    int read(float *dst, int n) {
+        const int r = read_pos.fetchAndAddOrdered(0);
+        n = qMin(n, int(unsigned(write_pos.fetchAndAddOrdered(0)) - unsigned(r)));
+        n -= n % channels;
+        const int pos = r & mask;
+        const int first = qMin(n, capacity() - pos);
+        memcpy(dst, buffer.constData() + pos, first*sizeof(float));
+        memcpy(dst + first, buffer.constData(), (n - first)*sizeof(float));
+        //the space can be reused after the data is read. discarded meanwhile: the data may be overwritten
+        if (!read_pos.testAndSetOrdered(r, r + n))
+            return 0;
+        return n;
+    }
+
+private:
+    QVector<float> buffer;
+    int mask;
+    int channels;
+    QAtomicInt read_pos, write_pos;
+};
+
+} //namespace QtAV
+#endif // QTAV_AUDIORING_P_H
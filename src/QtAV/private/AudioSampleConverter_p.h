@@ -0,0 +1,57 @@
+/******************************************************************************
+    QtAV:  Media play library based on Qt and FFmpeg
+    Copyright (C) 2012-2013 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+
+#ifndef QTAV_AUDIOSAMPLECONVERTER_P_H
+#define QTAV_AUDIOSAMPLECONVERTER_P_H
+
+#include <QtAV/QtAV_Global.h>
+
+namespace QtAV {
+
+/*
+ * Converts the decoded samples(AVSampleFormat U8/S16/S32/FLT/DBL and the planar formats) to interleaved float.
+ * The SSE2/AVX2 kernels are selected at runtime. The results are exactly the same as the C code.
+ */
+class Q_EXPORT AudioSampleConverter
+{
+public:
+    enum Kernels {
+        Auto, //the fastest supported by the cpu
+        C,
+        SSE2,
+        AVX2
+    };
+    //if the kernels is not supported by the cpu or the build, the fastest supported ones are used
+    AudioSampleConverter(Kernels kernels = Auto);
+    Kernels kernels() const;
+    /*
+     * in: AVFrame.extended_data. samples: per channel. out: samples*channels floats
+     * Returns false if the format is not supported
+     */
+    bool toFloat(int sampleFormat, const quint8 *const in[], int channels, int samples, float *out) const;
+
+private:
+    Kernels kernels_;
+};
+
+} //namespace QtAV
+#endif // QTAV_AUDIOSAMPLECONVERTER_P_H
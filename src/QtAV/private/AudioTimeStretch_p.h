@@ -0,0 +1,85 @@
+/******************************************************************************
+    QtAV:  Media play library based on Qt and FFmpeg
+    Copyright (C) 2012-2013 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+
+
+#ifndef QTAV_AUDIOTIMESTRETCH_P_H
+#define QTAV_AUDIOTIMESTRETCH_P_H
+
+#include <QtAV/QtAV_Global.h>
+#include <QtCore/QByteArray>
+#include <QtCore/QVector>
+
+namespace QtAV {
+
+/*
+ * Changes the speed of interleaved float samples without changing the pitch, by WSOLA(waveform similarity
+ * overlap-add). Each output hop is cross-faded from the natural continuation of the previous segment to the
+ * input segment near the nominal position which is the most similar to it. The similarity is searched in the
+ * mono downmix. The correlation and cross-fade kernels are SSE2/AVX2, selected at runtime.
+ */
+class Q_EXPORT AudioTimeStretch
+{
+public:
+    enum Kernels {
+        Auto, //the fastest supported by the cpu
+        C,
+        SSE2,
+        AVX2
+    };
+    //if the kernels is not supported by the cpu or the build, the fastest supported ones are used
+    AudioTimeStretch(Kernels kernels = Auto);
+    Kernels kernels() const;
+    //the buffered samples are dropped if the format changes
+    void setFormat(int sampleRate, int channels);
+    //output duration = input duration / speed. 1.0: the samples are not changed
+    void setSpeed(qreal speed);
+    qreal speed() const;
+    //speed is 1.0 and no samples are buffered. process() is not required
+    bool isPassThrough() const;
+    /*
+     * in: samples per channel, interleaved. out is replaced by the stretched samples, may be less or empty
+     * because some input is buffered. out is reused if nobody else holds it
+     */
+    void process(const float *in, int samples, QByteArray *out);
+    //input duration in seconds not output yet, i.e. the delay in media time
+    qreal buffered() const;
+    //drop the buffered samples, e.g. after seeking
+    void reset();
+
+private:
+    //removes the samples not required any more
+    void discard();
+
+    Kernels kernels_;
+    int rate, channels;
+    int overlap; //frames of the cross-fade, also the output hop
+    int search; //max distance in frames from the nominal position
+    qreal speed_;
+    QVector<float> input; //interleaved
+    QVector<float> mono; //downmix of input for searching
+    QVector<float> fade; //rising window of overlap frames, repeated for each channel
+    qreal pos; //nominal input position of the next segment, in frames
+    int tail; //start of the natural continuation of the last output segment. <0: nothing is output
+};
+
+} //namespace QtAV
+#endif // QTAV_AUDIOTIMESTRETCH_P_H
@@ -0,0 +1,55 @@
+/******************************************************************************
+    QtAV:  Media play library based on Qt and FFmpeg
+    Copyright (C) 2012-2013 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+
+
+#ifndef QTAV_IMAGECONVERTERSIMD_P_H
+#define QTAV_IMAGECONVERTERSIMD_P_H
+
+#include <QtAV/ImageConverter.h>
+
+namespace QtAV {
+
+/*
+ * YUV420P/NV12/YUV422P => RGB32/BGR32 with bilinear scaling. The SSE2/SSSE3/AVX2 kernels are selected at
+ * runtime. The results are exactly the same as the C code. Other formats and interlaced pictures are converted
+ * by ImageConverterFF. Usually created by ImageConverterFactory with ImageConverterId_SIMD
+ */
+class ImageConverterSIMDPrivate;
+class Q_EXPORT ImageConverterSIMD : public ImageConverter
+{
+    DPTR_DECLARE_PRIVATE(ImageConverterSIMD)
+public:
+    enum Kernels {
+        Auto, //the fastest supported by the cpu
+        C,
+        SSE2,
+        SSSE3,
+        AVX2
+    };
+    //if the kernels is not supported by the cpu or the build, the fastest supported ones are used
+    ImageConverterSIMD(Kernels kernels = Auto);
+    Kernels kernels() const;
+    virtual bool convert(const quint8 *const srcSlice[], const int srcStride[], quint8 *const dst[], const int dstStride[]);
+};
+
+} //namespace QtAV
+#endif // QTAV_IMAGECONVERTERSIMD_P_H
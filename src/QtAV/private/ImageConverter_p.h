@@ -26,18 +26,24 @@
 #include <QtAV/QtAV_Compat.h>
 #include <QtCore/QByteArray>
 
+class QThreadPool;
 namespace QtAV {
 
+//runs the bands converted in parallel. shared by all converters
+QThreadPool* imageConvertThreadPool();
+
 class ImageConverter;
 class Q_EXPORT ImageConverterPrivate : public DPtrPrivate<ImageConverter>
 {
 public:
     ImageConverterPrivate():interlaced(false),w_in(0),h_in(0),w_out(0),h_out(0)
-      ,fmt_in(PIX_FMT_YUV420P),fmt_out(PIX_FMT_RGB32){}
+      ,fmt_in(PIX_FMT_YUV420P),fmt_out(PIX_FMT_RGB32),threads(0){}
     bool interlaced;
     int w_in, h_in, w_out, h_out;
     int fmt_in, fmt_out;
+    int threads; //0: auto
     QByteArray data_out;
+    AVPicture picture; //planes in data_out
 };
 
 } //namespace QtAV
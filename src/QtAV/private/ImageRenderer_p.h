@@ -24,15 +24,59 @@
 #define QTAV_IMAGERENDERER_P_H
 
 #include <QtGui/QImage>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QEvent>
 #include <private/VideoRenderer_p.h>
 
 namespace QtAV {
 
+/*
+ * Triple buffer. The video thread writes the frame into the write slot then swaps it with the latest slot,
+ * the painter swaps the latest slot with the read slot if a new frame is published. Only the latest index
+ * is shared, so the video thread and the painter never wait for each other and never touch the same image.
+ */
 class Q_EXPORT ImageRendererPrivate : public VideoRendererPrivate
 {
 public:
+    ImageRendererPrivate():write_index(0),read_index(1),latest(2),repaint_pending(0),overwritten(0),dropped(0){}
     virtual ~ImageRendererPrivate(){}
-    QImage image;
+    //called by the video thread after frames[write_index] is written
+    void publish() {
+        const int last = latest.fetchAndStoreOrdered(write_index | kFresh);
+        write_index = last & kIndexMask;
+        if (last & kFresh) //replaced before it is painted
+            overwritten.fetchAndAddOrdered(1);
+    }
+    //called by the painter once per paint. the latest complete image
+    QImage& acquireImage() {
+        if (latest.fetchAndAddOrdered(0) & kFresh)
+            read_index = latest.fetchAndStoreOrdered(read_index) & kIndexMask;
+        return frames[read_index].image;
+    }
+    /*
+     * Called by the video thread after publish(). Posts a repaint event to receiver unless one is pending.
+     * The pending repaint paints the latest frame, so the frames published meanwhile are just overwritten.
+     * The video thread never touches the widget or the scene.
+     */
+    void scheduleRepaint(QObject *receiver);
+    /*
+     * Called by the receiver when the repaint event is delivered, whether or not it paints. A frame published
+     * later schedules a new repaint, so the flag never stays set if update() does not cause a paint
+     */
+    void repaintEventReceived() { repaint_pending.fetchAndStoreOrdered(0); }
+    static QEvent::Type repaintEventType();
+
+    enum { kIndexMask = 0x3, kFresh = 0x4 };
+    struct Frame {
+        QByteArray data; //QImage does not own the data
+        QImage image;
+    };
+    Frame frames[3];
+    int write_index; //used by the video thread only
+    int read_index; //used by the painter only
+    QAtomicInt latest; //index of the last published frame. kFresh is set until it is painted
+    QAtomicInt repaint_pending;
+    QAtomicInt overwritten, dropped;
 };
 
 } //namespace QtAV
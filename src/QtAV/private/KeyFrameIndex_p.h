@@ -0,0 +1,83 @@
+/******************************************************************************
+    QtAV:  Media play library based on Qt and FFmpeg
+    Copyright (C) 2012-2013 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+
+#ifndef QTAV_KEYFRAMEINDEX_P_H
+#define QTAV_KEYFRAMEINDEX_P_H
+
+#include <QtAV/QtAV_Global.h>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+
+namespace QtAV {
+
+/*
+ * Key frame index(pts -> byte position) of a stream in a local file. The file is scanned in a low priority thread
+ * with its own AVFormatContext, so the playing demuxer is not affected. Only the key packets of the stream are read.
+ * The index is saved next to the media as fileName.qtavidx when completed, and is loaded instead of scanning next
+ * time if the file's size and modified time are not changed.
+ * The entries found so far can be used while scanning.
+ */
+class Q_EXPORT KeyFrameIndex : public QThread
+{
+public:
+    struct Entry {
+        qreal pts; //seconds. the same as Packet::pts
+        qint64 pos; //byte position in the file
+    };
+
+    KeyFrameIndex(QObject *parent = 0);
+    ~KeyFrameIndex(); //stops scanning
+    //load the saved index or start scanning the stream. stop() the previous scanning first
+    void build(const QString& fileName, int stream);
+    //stop scanning and wait. the entries found are kept but not saved
+    void stop();
+    bool isComplete() const;
+    int size() const;
+    /*
+     * before: the last key frame not later than pts, otherwise the nearest one.
+     * false if not found, or pts is beyond the entries scanned and the index is not complete
+     */
+    bool find(qreal pts, bool before, Entry *entry) const;
+
+protected:
+    virtual void run();
+
+private:
+    static QString indexFile(const QString& fileName);
+    bool load();
+    bool save() const;
+    static int interruptCallback(void *obj);
+
+    QString file_name;
+    int stream;
+    qint64 file_size, file_mtime; //when build() is called. msecs since epoch
+    volatile bool stopped;
+    volatile bool complete;
+    mutable QMutex mutex; //entries
+    QVector<Entry> entries; //sorted by pts
+};
+
+} //namespace QtAV
+
+#endif // QTAV_KEYFRAMEINDEX_P_H
@@ -0,0 +1,69 @@
+/******************************************************************************
+    QtAV:  Media play library based on Qt and FFmpeg
+    Copyright (C) 2012-2013 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+
+#ifndef QTAV_MAPPEDIO_P_H
+#define QTAV_MAPPEDIO_P_H
+
+#include <QtAV/QtAV_Global.h>
+#include <QtCore/QFile>
+#include <stdint.h>
+
+struct AVIOContext;
+
+namespace QtAV {
+
+/*
+ * An AVIOContext reading a local file from a memory mapped region instead of read() calls. The pages are shared
+ * with the page cache, so the players reading the same file do not copy it into the kernel and again into the
+ * context's buffer. The region is advised sequential, and the pages a few MB ahead of the read position are
+ * advised to be needed(POSIX only). The file must not be truncated while it's mapped.
+ */
+class Q_EXPORT MappedIO
+{
+public:
+    MappedIO();
+    ~MappedIO(); //close()
+    //false if the file can not be mapped, e.g. not a regular file, or not enough address space
+    bool open(const QString& fileName);
+    //the context must not be used by any AVFormatContext
+    void close();
+    bool isOpen() const;
+    //set as AVFormatContext.pb with AVFMT_FLAG_CUSTOM_IO before avformat_open_input()
+    AVIOContext* context() const;
+
+private:
+    //the callbacks of the context
+    static int read(void *opaque, uint8_t *buf, int buf_size);
+    static int64_t seek(void *opaque, int64_t offset, int whence);
+    void adviseAhead();
+
+    QFile file;
+    uchar *data;
+    qint64 data_size;
+    qint64 pos;
+    qint64 advised; //the end of the region advised to be needed
+    AVIOContext *io;
+};
+
+} //namespace QtAV
+
+#endif // QTAV_MAPPEDIO_P_H
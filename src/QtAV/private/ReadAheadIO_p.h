@@ -0,0 +1,100 @@
+/******************************************************************************
+    QtAV:  Media play library based on Qt and FFmpeg
+    Copyright (C) 2012-2013 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+
+#ifndef QTAV_READAHEADIO_P_H
+#define QTAV_READAHEADIO_P_H
+
+#include <QtAV/QtAV_Global.h>
+#include <QtCore/QByteArray>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+#include <stdint.h>
+
+struct AVIOContext;
+struct AVIOInterruptCB;
+
+namespace QtAV {
+
+/*
+ * An AVIOContext reading from a ring buffer which is filled by an I/O thread ahead of the read position, so a slow
+ * read of the protocol(disk or network) does not stall the demuxer if enough data is buffered.
+ * The ring keeps a quarter of it behind the read position. A seek into the buffered window is a hit and served
+ * from the ring, otherwise it's a miss and the I/O thread seeks the protocol and refills the ring.
+ */
+class Q_EXPORT ReadAheadIO : public QThread
+{
+public:
+    ReadAheadIO();
+    ~ReadAheadIO(); //close()
+    /*
+     * Open url with avio_open2() and start the I/O thread. bufferBytes: the ring size.
+     * interrupt: the callback of the demuxer. it interrupts the protocol and the waiting for data
+     */
+    bool open(const QString& url, int bufferBytes, const AVIOInterruptCB *interrupt);
+    //stop the I/O thread and close the protocol. the context must not be used by any AVFormatContext
+    void close();
+    bool isOpen() const;
+    //set as AVFormatContext.pb with AVFMT_FLAG_CUSTOM_IO before avformat_open_input()
+    AVIOContext* context() const;
+
+    //statistics since open()
+    int seekHits() const;
+    int seekMisses() const;
+    int readStalls() const; //reads waited for the I/O thread
+
+protected:
+    virtual void run();
+
+private:
+    static int read(void *opaque, uint8_t *buf, int buf_size);
+    static int64_t seek(void *opaque, int64_t offset, int whence);
+    static int interruptCallback(void *opaque);
+    bool isInterrupted() const; //by the demuxer
+
+    AVIOContext *src; //the protocol
+    AVIOContext *io;
+    int (*interrupt_cb)(void*); //the demuxer's
+    void *interrupt_opaque;
+    qint64 src_size; //<0: unknown
+    QByteArray ring;
+    char *ring_data; //not detached
+    int capacity;
+    //the file range [win_begin, win_end) is in the ring, offset o is at o%capacity. win_begin <= pos <= win_end
+    qint64 win_begin, win_end, pos;
+    bool eof;
+    int error; //the error of the protocol. 0: none
+    volatile bool stopped;
+    //a seek missed the window. the I/O thread seeks the protocol to seek_pos
+    bool seek_pending;
+    bool seek_started; //the I/O thread is seeking. the window is changed by the result
+    qint64 seek_pos;
+    int seek_result;
+    int hits, misses, stalls;
+    mutable QMutex mutex;
+    QWaitCondition data_cond; //data, eof or error is available, or the pending seek is done
+    QWaitCondition space_cond; //space is available, or a seek is requested
+};
+
+} //namespace QtAV
+
+#endif // QTAV_READAHEADIO_P_H
@@ -0,0 +1,58 @@
+/******************************************************************************
+    QtAV:  Media play library based on Qt and FFmpeg
+    Copyright (C) 2012-2013 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+
+
+#ifndef QTAV_SIMD_P_H
+#define QTAV_SIMD_P_H
+
+/*
+ * The x86 SIMD levels the compiler can build. QTAV_HAVE_XXX: the kernels of the level can be compiled, they are
+ * selected at runtime by av_get_cpu_flags(). QTAV_TARGET(x) enables the instruction set for a function only
+ * (GCC and clang), so the library is built without -mavx2 and still runs on older cpus.
+ * The kernel tables are built once by Q_GLOBAL_STATIC, not by function-local statics which are not thread safe
+ * with every supported compiler(e.g. MSVC 2013).
+ */
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#define QTAV_HAVE_SSE2 1
+#define QTAV_HAVE_SSSE3 1
+#define QTAV_HAVE_AVX2 1
+#define QTAV_TARGET(x) __attribute__((target(x)))
+#elif defined(_MSC_VER)
+#define QTAV_HAVE_SSE2 1
+#define QTAV_HAVE_SSSE3 1
+#define QTAV_HAVE_AVX2 (_MSC_VER >= 1800)
+#define QTAV_TARGET(x)
+#endif
+#endif //x86
+
+#if QTAV_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+#if QTAV_HAVE_SSSE3
+#include <tmmintrin.h>
+#endif
+#if QTAV_HAVE_AVX2
+#include <immintrin.h>
+#endif
+
+#endif // QTAV_SIMD_P_H
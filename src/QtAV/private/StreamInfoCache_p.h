@@ -0,0 +1,53 @@
+/******************************************************************************
+    QtAV:  Media play library based on Qt and FFmpeg
+    Copyright (C) 2012-2013 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+
+#ifndef QTAV_STREAMINFOCACHE_P_H
+#define QTAV_STREAMINFOCACHE_P_H
+
+#include <QtAV/QtAV_Global.h>
+#include <QtCore/QString>
+
+struct AVFormatContext;
+
+namespace QtAV {
+
+/*
+ * On-disk cache of the stream info found by avformat_find_stream_info(), i.e. the codec parameters, frame rates,
+ * durations and extradata. The entries are keyed by the local file's path, size and modified time, and stored in
+ * the QtAV/streaminfo directory of the temp path. restore() fills the unknown parameters of a context opened by
+ * avformat_open_input(), so probing can be skipped.
+ */
+class Q_EXPORT StreamInfoCache
+{
+public:
+    //false if the file is not cached, changed, or the streams do not match the context's
+    static bool restore(AVFormatContext *ctx, const QString& fileName);
+    //only local files are stored
+    static bool store(AVFormatContext *ctx, const QString& fileName);
+
+private:
+    static QString cacheFile(const QString& fileName);
+};
+
+} //namespace QtAV
+
+#endif // QTAV_STREAMINFOCACHE_P_H
@@ -0,0 +1,283 @@
+/******************************************************************************
+    QtAV:  Media play library based on Qt and FFmpeg
+    Copyright (C) 2012-2013 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+
+#include <private/ReadAheadIO_p.h>
+#include <QtAV/QtAV_Compat.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace QtAV {
+
+static const int kBufferSize = 32*1024; //the context's buffer
+static const int kReadChunk = 256*1024; //max bytes of a protocol read, so the window grows smoothly
+static const unsigned long kWaitSlice = 10; //ms. a waiting reader checks the demuxer's interrupt callback
+
+ReadAheadIO::ReadAheadIO()
+    :QThread(0),src(0),io(0),interrupt_cb(0),interrupt_opaque(0),src_size(-1),ring_data(0),capacity(0)
+    ,win_begin(0),win_end(0),pos(0),eof(false),error(0),stopped(false)
+    ,seek_pending(false),seek_started(false),seek_pos(0),seek_result(0),hits(0),misses(0),stalls(0)
+{
+}
+
+ReadAheadIO::~ReadAheadIO()
+{
+    close();
+}
+
+bool ReadAheadIO::open(const QString &url, int bufferBytes, const AVIOInterruptCB *interrupt)
+{
+    close();
+    interrupt_cb = interrupt ? interrupt->callback : 0;
+    interrupt_opaque = interrupt ? interrupt->opaque : 0;
+    stopped = false;
+    AVIOInterruptCB cb = { interruptCallback, this };
+    int ret = avio_open2(&src, qPrintable(url), AVIO_FLAG_READ, &cb, NULL);
+    if (ret < 0) {
+        qWarning("[ReadAheadIO] can not open %s: %s", qPrintable(url), av_err2str(ret));
+        src = 0;
+        return false;
+    }
+    src_size = avio_size(src);
+    capacity = bufferBytes;
+    ring.resize(capacity);
+    ring_data = ring.data();
+    win_begin = win_end = pos = 0;
+    eof = false;
+    error = 0;
+    seek_pending = seek_started = false;
+    hits = misses = stalls = 0;
+    uint8_t *buffer = (uint8_t*)av_malloc(kBufferSize);
+    io = avio_alloc_context(buffer, kBufferSize, 0, this, &ReadAheadIO::read, 0, &ReadAheadIO::seek);
+    if (!io) {
+        av_free(buffer);
+        close();
+        return false;
+    }
+    io->seekable = src->seekable;
+    start();
+    return true;
+}
+
+void ReadAheadIO::close()
+{
+    if (isRunning()) {
+        {
+            QMutexLocker lock(&mutex);
+            Q_UNUSED(lock);
+            stopped = true; //interrupts the protocol too
+            space_cond.wakeAll();
+            data_cond.wakeAll();
+        }
+        wait();
+    }
+    if (io) {
+        av_free(io->buffer); //may be reallocated by the context
+        av_free(io);
+        io = 0;
+    }
+    if (src) {
+        avio_close(src);
+        src = 0;
+    }
+    ring.clear();
+    ring_data = 0;
+    capacity = 0;
+}
+
+bool ReadAheadIO::isOpen() const
+{
+    return !!io;
+}
+
+AVIOContext* ReadAheadIO::context() const
+{
+    return io;
+}
+
+int ReadAheadIO::seekHits() const
+{
+    QMutexLocker lock(&mutex);
+    Q_UNUSED(lock);
+    return hits;
+}
+
+int ReadAheadIO::seekMisses() const
+{
+    QMutexLocker lock(&mutex);
+    Q_UNUSED(lock);
+    return misses;
+}
+
+int ReadAheadIO::readStalls() const
+{
+    QMutexLocker lock(&mutex);
+    Q_UNUSED(lock);
+    return stalls;
+}
+
+int ReadAheadIO::interruptCallback(void *opaque)
+{
+    ReadAheadIO *r = static_cast<ReadAheadIO*>(opaque);
+    return r->stopped || r->isInterrupted() ? 1 : 0;
+}
+
+bool ReadAheadIO::isInterrupted() const
+{
+    return interrupt_cb && interrupt_cb(interrupt_opaque);
+}
+
+void ReadAheadIO::run()
+{
+    QMutexLocker lock(&mutex);
+    Q_UNUSED(lock);
+    while (!stopped) {
+        if (seek_pending) {
+            const qint64 target = seek_pos;
+            seek_started = true;
+            lock.unlock();
+            const int64_t ret = avio_seek(src, target, SEEK_SET);
+            lock.relock();
+            seek_pending = seek_started = false;
+            if (ret < 0) {
+                seek_result = (int)ret;
+            } else {
+                win_begin = win_end = pos = target;
+                eof = false;
+                error = 0;
+                seek_result = 0;
+            }
+            data_cond.wakeAll();
+            continue;
+        }
+        if (eof || error) {
+            space_cond.wait(&mutex);
+            continue;
+        }
+        //the data more than a quarter of the ring behind the read position is dropped
+        win_begin = qMax(win_begin, pos - capacity/4);
+        const qint64 space = capacity - (win_end - win_begin);
+        if (space <= 0) {
+            space_cond.wait(&mutex);
+            continue;
+        }
+        //[win_end, win_end + len) does not overlap [win_begin, win_end) in the ring, so the readers are not blocked
+        const int index = int(win_end % capacity);
+        const int len = (int)qMin<qint64>(qMin<qint64>(space, capacity - index), kReadChunk);
+        char *dst = ring_data + index;
+        lock.unlock();
+        const int n = avio_read(src, (unsigned char*)dst, len);
+        lock.relock();
+        if (n > 0)
+            win_end += n;
+        else if (n == 0 || n == AVERROR_EOF)
+            eof = true;
+        else if (n == AVERROR_EXIT || n == AVERROR(EAGAIN)) {
+            /*
+             * interrupted, e.g. by the demuxer's timeout. not an error of the protocol, retry later. clear the
+             * error and eof flag the context keeps for the interrupted read, otherwise the next reads fail too
+             */
+            src->eof_reached = 0;
+            src->error = 0;
+            if (!stopped)
+                space_cond.wait(&mutex, kWaitSlice);
+            continue; //the waiting readers are interrupted by themselves
+        } else
+            error = n;
+        data_cond.wakeAll();
+    }
+}
+
+int ReadAheadIO::read(void *opaque, uint8_t *buf, int buf_size)
+{
+    ReadAheadIO *r = static_cast<ReadAheadIO*>(opaque);
+    QMutexLocker lock(&r->mutex);
+    Q_UNUSED(lock);
+    if (r->pos == r->win_end && !r->eof && !r->error)
+        ++r->stalls;
+    while (r->pos == r->win_end && !r->eof && !r->error) {
+        if (r->stopped || r->isInterrupted())
+            return AVERROR_EXIT;
+        r->data_cond.wait(&r->mutex, kWaitSlice);
+    }
+    if (r->pos == r->win_end)
+        return r->error ? r->error : AVERROR_EOF;
+    const int n = (int)qMin<qint64>(buf_size, r->win_end - r->pos);
+    const int index = int(r->pos % r->capacity);
+    const int first = qMin(n, r->capacity - index);
+    memcpy(buf, r->ring_data + index, first);
+    if (n > first)
+        memcpy(buf + first, r->ring_data, n - first);
+    r->pos += n;
+    r->space_cond.wakeAll();
+    return n;
+}
+
+int64_t ReadAheadIO::seek(void *opaque, int64_t offset, int whence)
+{
+    ReadAheadIO *r = static_cast<ReadAheadIO*>(opaque);
+    QMutexLocker lock(&r->mutex);
+    Q_UNUSED(lock);
+    qint64 target = 0;
+    switch (whence & ~AVSEEK_FORCE) {
+    case AVSEEK_SIZE:
+        return r->src_size;
+    case SEEK_SET:
+        target = offset;
+        break;
+    case SEEK_CUR:
+        target = r->pos + offset;
+        break;
+    case SEEK_END:
+        if (r->src_size < 0)
+            return -1;
+        target = r->src_size + offset;
+        break;
+    default:
+        return -1;
+    }
+    if (target < 0)
+        return -1;
+    if (target >= r->win_begin && target <= r->win_end) {
+        ++r->hits;
+        r->pos = target;
+        r->space_cond.wakeAll();
+        return target;
+    }
+    ++r->misses;
+    r->seek_pos = target;
+    r->seek_pending = true;
+    r->space_cond.wakeAll();
+    while (r->seek_pending) {
+        /*
+         * not started: cancel it, the window and the position are not changed. started: the protocol is
+         * interrupted by the same callback, wait for the result, so the position is what the result says
+         */
+        if (!r->seek_started && (r->stopped || r->isInterrupted())) {
+            r->seek_pending = false;
+            return AVERROR_EXIT;
+        }
+        r->data_cond.wait(&r->mutex, kWaitSlice);
+    }
+    return r->seek_result < 0 ? r->seek_result : target;
+}
+
+} //namespace QtAV
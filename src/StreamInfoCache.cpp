@@ -0,0 +1,220 @@
+/******************************************************************************
+    QtAV:  Media play library based on Qt and FFmpeg
+    Copyright (C) 2012-2013 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+
+#include <private/StreamInfoCache_p.h>
+#include <QtAV/QtAV_Compat.h>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QVector>
+#include <string.h>
+
+namespace QtAV {
+
+static const quint32 kCacheMagic = 0x51415653; //"QAVS"
+static const quint32 kCacheVersion = 1;
+
+//the key of a file. the path is in the file name of the cache, the others are checked when restoring
+struct FileKey {
+    QString path;
+    qint64 size, mtime;
+};
+
+static bool fileKey(const QString& fileName, FileKey *key)
+{
+    QFileInfo fi(fileName);
+    if (!fi.isFile())
+        return false;
+    key->path = fi.absoluteFilePath();
+    key->size = fi.size();
+    key->mtime = fi.lastModified().toMSecsSinceEpoch();
+    return true;
+}
+
+static QDataStream& operator<<(QDataStream& ds, const AVRational& r)
+{
+    return ds << (qint32)r.num << (qint32)r.den;
+}
+
+static QDataStream& operator>>(QDataStream& ds, AVRational& r)
+{
+    qint32 num = 0, den = 0;
+    ds >> num >> den;
+    r.num = num;
+    r.den = den;
+    return ds;
+}
+
+QString StreamInfoCache::cacheFile(const QString &fileName)
+{
+    const QByteArray hash = QCryptographicHash::hash(QFileInfo(fileName).absoluteFilePath().toUtf8(), QCryptographicHash::Md5);
+    return QDir::tempPath() + "/QtAV/streaminfo/" + hash.toHex() + ".info";
+}
+
+bool StreamInfoCache::store(AVFormatContext *ctx, const QString &fileName)
+{
+    FileKey key;
+    if (!ctx || !fileKey(fileName, &key))
+        return false;
+    const QString path = cacheFile(fileName);
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning("[StreamInfoCache] can not write %s: %s", qPrintable(path), qPrintable(f.errorString()));
+        return false;
+    }
+    QDataStream ds(&f);
+    ds << kCacheMagic << kCacheVersion << key.path << key.size << key.mtime;
+    ds << (qint64)ctx->duration << (qint64)ctx->start_time << (qint32)ctx->bit_rate << (quint32)ctx->nb_streams;
+    for (unsigned int i = 0; i < ctx->nb_streams; ++i) {
+        const AVStream *st = ctx->streams[i];
+        const AVCodecContext *c = st->codec;
+        ds << (qint32)c->codec_type << (qint32)c->codec_id << (quint32)c->codec_tag << (qint32)c->bit_rate;
+        ds << (qint32)c->width << (qint32)c->height << (qint32)c->pix_fmt << c->sample_aspect_ratio;
+        ds << (qint32)c->sample_rate << (qint32)c->channels << (quint64)c->channel_layout << (qint32)c->sample_fmt;
+        ds << c->time_base << (qint32)c->ticks_per_frame << (qint32)c->has_b_frames;
+        ds << st->r_frame_rate << st->avg_frame_rate << st->sample_aspect_ratio;
+        ds << (qint64)st->duration << (qint64)st->start_time << (qint64)st->nb_frames;
+        ds << QByteArray((const char*)c->extradata, c->extradata ? c->extradata_size : 0);
+    }
+    return ds.status() == QDataStream::Ok;
+}
+
+bool StreamInfoCache::restore(AVFormatContext *ctx, const QString &fileName)
+{
+    FileKey key;
+    if (!ctx || !fileKey(fileName, &key))
+        return false;
+    QFile f(cacheFile(fileName));
+    if (!f.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream ds(&f);
+    quint32 magic = 0, version = 0;
+    FileKey cached;
+    ds >> magic >> version;
+    if (ds.status() != QDataStream::Ok || magic != kCacheMagic || version != kCacheVersion)
+        return false;
+    ds >> cached.path >> cached.size >> cached.mtime;
+    if (cached.path != key.path || cached.size != key.size || cached.mtime != key.mtime) {
+        qDebug("[StreamInfoCache] %s is changed", qPrintable(fileName));
+        return false;
+    }
+    qint64 duration = 0, start_time = 0;
+    qint32 bit_rate = 0;
+    quint32 nb_streams = 0;
+    ds >> duration >> start_time >> bit_rate >> nb_streams;
+    //some streams may be found only by probing
+    if (nb_streams != ctx->nb_streams) {
+        qDebug("[StreamInfoCache] %u streams cached, %u found", nb_streams, ctx->nb_streams);
+        return false;
+    }
+    //read all first. the context is not changed if the cache is invalid
+    struct Info {
+        qint32 type, id, bit_rate, width, height, pix_fmt, sample_rate, channels, sample_fmt, ticks_per_frame, has_b_frames;
+        quint32 tag;
+        quint64 channel_layout;
+        AVRational sar, time_base, r_frame_rate, avg_frame_rate, st_sar;
+        qint64 duration, start_time, nb_frames;
+        QByteArray extradata;
+    };
+    QVector<Info> infos(nb_streams);
+    for (unsigned int i = 0; i < nb_streams; ++i) {
+        Info &s = infos[i];
+        ds >> s.type >> s.id >> s.tag >> s.bit_rate;
+        ds >> s.width >> s.height >> s.pix_fmt >> s.sar;
+        ds >> s.sample_rate >> s.channels >> s.channel_layout >> s.sample_fmt;
+        ds >> s.time_base >> s.ticks_per_frame >> s.has_b_frames;
+        ds >> s.r_frame_rate >> s.avg_frame_rate >> s.st_sar;
+        ds >> s.duration >> s.start_time >> s.nb_frames;
+        ds >> s.extradata;
+        const AVCodecContext *c = ctx->streams[i]->codec;
+        //the type and the codec are found by the demuxer when opening
+        if ((qint32)c->codec_type != s.type || (qint32)c->codec_id != s.id)
+            return false;
+    }
+    if (ds.status() != QDataStream::Ok) {
+        qWarning("[StreamInfoCache] invalid cache of %s", qPrintable(fileName));
+        return false;
+    }
+    //fill the parameters not known by the demuxer
+    if (ctx->duration == (int64_t)AV_NOPTS_VALUE || ctx->duration <= 0)
+        ctx->duration = duration;
+    if (ctx->start_time == (int64_t)AV_NOPTS_VALUE)
+        ctx->start_time = start_time;
+    if (ctx->bit_rate <= 0)
+        ctx->bit_rate = bit_rate;
+    for (unsigned int i = 0; i < nb_streams; ++i) {
+        const Info &s = infos[i];
+        AVStream *st = ctx->streams[i];
+        AVCodecContext *c = st->codec;
+        if (!c->codec_tag)
+            c->codec_tag = s.tag;
+        if (c->bit_rate <= 0)
+            c->bit_rate = s.bit_rate;
+        if (c->width <= 0 || c->height <= 0) {
+            c->width = s.width;
+            c->height = s.height;
+        }
+        if (c->pix_fmt == PIX_FMT_NONE)
+            c->pix_fmt = (PixelFormat)s.pix_fmt;
+        if (!c->sample_aspect_ratio.num)
+            c->sample_aspect_ratio = s.sar;
+        if (c->sample_rate <= 0)
+            c->sample_rate = s.sample_rate;
+        if (c->channels <= 0)
+            c->channels = s.channels;
+        if (!c->channel_layout)
+            c->channel_layout = s.channel_layout;
+        if (c->sample_fmt == AV_SAMPLE_FMT_NONE)
+            c->sample_fmt = (AVSampleFormat)s.sample_fmt;
+        if (!c->time_base.num)
+            c->time_base = s.time_base;
+        c->ticks_per_frame = s.ticks_per_frame;
+        if (!c->has_b_frames)
+            c->has_b_frames = s.has_b_frames;
+        if (!st->r_frame_rate.num)
+            st->r_frame_rate = s.r_frame_rate;
+        if (!st->avg_frame_rate.num)
+            st->avg_frame_rate = s.avg_frame_rate;
+        if (!st->sample_aspect_ratio.num)
+            st->sample_aspect_ratio = s.st_sar;
+        if (st->duration == (int64_t)AV_NOPTS_VALUE)
+            st->duration = s.duration;
+        if (st->start_time == (int64_t)AV_NOPTS_VALUE)
+            st->start_time = s.start_time;
+        if (st->nb_frames <= 0)
+            st->nb_frames = s.nb_frames;
+        if (!c->extradata && !s.extradata.isEmpty()) {
+            c->extradata = (uint8_t*)av_mallocz(s.extradata.size() + FF_INPUT_BUFFER_PADDING_SIZE);
+            if (c->extradata) {
+                memcpy(c->extradata, s.extradata.constData(), s.extradata.size());
+                c->extradata_size = s.extradata.size();
+            }
+        }
+    }
+    return true;
+}
+
+} //namespace QtAV
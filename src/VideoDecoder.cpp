@@ -33,9 +33,10 @@ namespace QtAV {
 class VideoDecoderPrivate : public AVDecoderPrivate
 {
 public:
-    VideoDecoderPrivate():width(0),height(0)
+    VideoDecoderPrivate():width(0),height(0),hurry_up(VideoDecoder::HurryNone),convert(true),no_frame(false),pts(-1)
     {
-        conv = ImageConverterFactory::create(ImageConverterId_FF); //TODO: set in AVPlayer
+        //SIMD converts the common formats and uses FFmpeg for others
+        conv = ImageConverterFactory::create(ImageConverterId_SIMD);
         conv->setOutFormat(PIX_FMT);
     }
     ~VideoDecoderPrivate() {
@@ -47,36 +48,96 @@ public:
 
     int width, height;
     ImageConverter* conv;
+    VideoDecoder::HurryUp hurry_up;
+    bool convert;
+    bool no_frame; //see isFrameSkipped()
+    qreal pts;
 };
 
 VideoDecoder::VideoDecoder()
     :AVDecoder(*new VideoDecoderPrivate())
 {
 }
-//TODO: use ipp, cuda decode and yuv functions. is sws_scale necessary?
+
+void VideoDecoder::setHurryUp(HurryUp mode)
+{
+    DPTR_D(VideoDecoder);
+    d.hurry_up = mode;
+    if (!d.codec_ctx)
+        return;
+    //the decoding thread calls it between 2 decode() calls, so the codec context is not being used
+    switch (mode) {
+    case HurryNonRef:
+        d.codec_ctx->skip_frame = AVDISCARD_NONREF;
+        d.codec_ctx->skip_loop_filter = AVDISCARD_ALL;
+        break;
+    case HurryKeyFrame:
+        d.codec_ctx->skip_frame = AVDISCARD_NONKEY;
+        d.codec_ctx->skip_loop_filter = AVDISCARD_ALL;
+        break;
+    case HurrySkipNonRef:
+        d.codec_ctx->skip_frame = AVDISCARD_NONREF;
+        d.codec_ctx->skip_loop_filter = AVDISCARD_DEFAULT;
+        break;
+    default:
+        d.codec_ctx->skip_frame = AVDISCARD_DEFAULT;
+        d.codec_ctx->skip_loop_filter = AVDISCARD_DEFAULT;
+        break;
+    }
+}
+
+VideoDecoder::HurryUp VideoDecoder::hurryUp() const
+{
+    return d_func().hurry_up;
+}
+
+void VideoDecoder::setConvertEnabled(bool enabled)
+{
+    d_func().convert = enabled;
+}
+
+bool VideoDecoder::isConvertEnabled() const
+{
+    return d_func().convert;
+}
+
 bool VideoDecoder::decode(const QByteArray &encoded)
 {
     if (!isAvailable())
         return false;
-    DPTR_D(VideoDecoder);
+    //the decoder may read beyond the end of payload. av_new_packet() allocates the padding
     AVPacket packet;
-    av_new_packet(&packet, encoded.size());
-    memcpy(packet.data, encoded.data(), encoded.size());
-//TODO: use AVPacket directly instead of Packet?
-    //AVStream *stream = format_context->streams[stream_idx];
+    if (av_new_packet(&packet, encoded.size()) < 0)
+        return false;
+    memcpy(packet.data, encoded.constData(), encoded.size());
+    return decode(Packet::fromAVPacket(&packet, 1.0));
+}
 
-    //TODO: some decoders might in addition need other fields like flags&AV_PKT_FLAG_KEY
-    int ret = avcodec_decode_video2(d.codec_ctx, d.frame, &d.got_frame_ptr, &packet);
+//TODO: use ipp, cuda decode and yuv functions. is sws_scale necessary?
+bool VideoDecoder::decode(const Packet &packet)
+{
+    if (!isAvailable())
+        return false;
+    if (!packet.asAVPacket())
+        return decode(packet.data);
+    DPTR_D(VideoDecoder);
+    d.no_frame = false;
+    //the demuxed packet is used directly. flags, side data and padding are kept
+    int ret = avcodec_decode_video2(d.codec_ctx, d.frame, &d.got_frame_ptr, packet.asAVPacket());
     //TODO: decoded format is YUV420P, YUV422P?
-    av_free_packet(&packet);
     if (ret < 0) {
         qWarning("[VideoDecoder] %s", av_err2str(ret));
         return false;
     }
     if (!d.got_frame_ptr) {
-        qWarning("no frame could be decompressed: %s", av_err2str(ret));
+        d.no_frame = true;
+        //expected if skip_frame is set
+        if (d.hurry_up == HurryNone)
+            qWarning("no frame could be decompressed: %s", av_err2str(ret));
         return false;
     }
+    const int64_t ts = d.frame->best_effort_timestamp;
+    d.pts = ts != AV_NOPTS_VALUE && packet.timeBase() > 0 ? qreal(ts)*packet.timeBase() : -1;
     d.conv->setInFormat(d.codec_ctx->pix_fmt);
     d.conv->setInSize(d.codec_ctx->width, d.codec_ctx->height);
     if (d.width <= 0 || d.height <= 0) {
@@ -89,12 +150,35 @@ bool VideoDecoder::decode(const QByteArray &encoded)
     //If not YUV420P or ImageConverter supported format pair, convert to YUV420P first. or directly convert to RGB?(no hwa)
     //TODO: move convertion out. decoder only do some decoding
     //if not yuv420p or conv supported convertion pair(in/out), convert to yuv420p first using ff, then use other yuv2rgb converter
+    if (!d.convert) {
+        d.decoded = QByteArray();
+        return true;
+    }
+    d.decoded = QByteArray(); //release the last frame so that the converter can reuse the buffer if nobody holds it
     if (!d.conv->convert(d.frame->data, d.frame->linesize))
         return false;
     d.decoded = d.conv->outData();
     return true;
 }
 
+bool VideoDecoder::convertTo(quint8 *const dst[], const int dstStride[])
+{
+    DPTR_D(VideoDecoder);
+    if (!d.got_frame_ptr || d.width <= 0 || d.height <= 0)
+        return false;
+    return d.conv->convert(d.frame->data, d.frame->linesize, dst, dstStride);
+}
+
+void VideoDecoder::setConvertThreads(int threads)
+{
+    d_func().conv->setThreads(threads);
+}
+
+int VideoDecoder::convertThreads() const
+{
+    return d_func().conv->threads();
+}
+
 void VideoDecoder::resizeVideoFrame(const QSize &size)
 {
     resizeVideoFrame(size.width(), size.height());
@@ -119,4 +203,14 @@ int VideoDecoder::height() const
 {
     return d_func().height;
 }
+
+bool VideoDecoder::isFrameSkipped() const
+{
+    return d_func().no_frame;
+}
+
+qreal VideoDecoder::framePts() const
+{
+    return d_func().pts;
+}
 } //namespace QtAV
@@ -21,29 +21,230 @@
 
 #include <QtAV/VideoThread.h>
 #include <private/AVThread_p.h>
+#include <QtAV/BlockingRing.h>
 #include <QtAV/Packet.h>
 #include <QtAV/AVClock.h>
 #include <QtAV/VideoCapture.h>
 #include <QtAV/VideoDecoder.h>
 #include <QtAV/VideoRenderer.h>
 #include <QtAV/ImageConverter.h>
+#include <QtCore/QVector>
 #include <QtGui/QImage>
 
 namespace QtAV {
 
+static const qreal kDropThreshold = 0.04; //drop a frame later than this if hurry up
+static const qreal kNonRefSpeed = 2.0; //faster than this, decode reference frames only
+//accurate seek: packets earlier than target - margin can not be the target frame even if reordered
+static const qreal kSeekNonRefMargin = 0.5;
+static const qreal kPtsEpsilon = 0.001;
+
+//accurate seek: the frame is displayed in [pts, pts + duration) which is before target
+static bool beforeSeekTarget(qreal pts, qreal duration, qreal target)
+{
+    if (duration > 0)
+        return pts + duration <= target + kPtsEpsilon;
+    return pts < target - kPtsEpsilon;
+}
+
+//the decoded frame's pts. the packet's if unknown
+static inline qreal framePts(const VideoDecoder *dec, const Packet& pkt)
+{
+    return dec->framePts() >= 0 ? dec->framePts() : pkt.pts;
+}
+
+/*
+ * Escalates when the average lateness of the presented frames stays high and de-escalates
+ * when video catches up. updated in presenting thread and the level is read in decoding thread
+ */
+class HurryUpPolicy
+{
+public:
+    enum Level {
+        Normal,
+        DropLate,     //do not display late frames
+        SkipConvert,  //decode late frames but do not convert
+        SkipNonRef,   //skip non-reference frames and the loop filter
+        KeyFrameOnly  //decode key frames only
+    };
+    HurryUpPolicy() { reset(); }
+    void reset() {
+        level = Normal;
+        lag = 0;
+        late_count = ok_count = 0;
+    }
+    //late: the frame's lateness in seconds. negative if early
+    void update(qreal late) {
+        lag = lag*0.875 + late*0.125;
+        if (lag > 0.05) {
+            ok_count = 0;
+            if (++late_count >= 8 && level < KeyFrameOnly) {
+                level = level + 1;
+                late_count = 0;
+                qDebug("video is late %f. hurry up level: %d", lag, level);
+            }
+        } else if (lag < 0.01) {
+            late_count = 0;
+            if (++ok_count >= 50 && level > Normal) {
+                level = level - 1;
+                ok_count = 0;
+                qDebug("video catches up. hurry up level: %d", level);
+            }
+        }
+    }
+
+    volatile int level;
+private:
+    qreal lag; //moving average
+    int late_count, ok_count;
+};
+
+//a frame decoded and converted ahead of the clock
+struct DecodedFrame
+{
+    DecodedFrame():skipped(false),seeked(false),width(0),height(0),pts(0),serial(0){}
+    bool isValid() const { return skipped || !data.isEmpty(); }
+    bool skipped; //decoded but not converted because it is late
+    bool seeked; //the first frame after seeking. displayed even if it's late
+    QByteArray data;
+    int width, height;
+    qreal pts;
+    int serial; //the packet's seek serial
+};
+
+//limited by frame count and bytes
+class DecodedFrameQueue : public BlockingRing<DecodedFrame>
+{
+public:
+    DecodedFrameQueue():max_bytes(0),bytes(0){}
+    void setMaxBytes(int value) { max_bytes = value; }
+
+protected:
+    virtual bool checkFull() const {
+        if (BlockingRing<DecodedFrame>::checkFull())
+            return true;
+        return max_bytes > 0 && const_cast<QAtomicInt&>(bytes).fetchAndAddOrdered(0) >= max_bytes;
+    }
+    //wake up the decoding thread as soon as it can put
+    virtual bool checkEnough() const { return checkFull(); }
+    virtual void onPut(const DecodedFrame& frame) { bytes.fetchAndAddOrdered(frame.data.size()); }
+    virtual void onTake(const DecodedFrame& frame) { bytes.fetchAndAddOrdered(-frame.data.size()); }
+
+private:
+    volatile int max_bytes;
+    QAtomicInt bytes;
+};
+
+class VideoDecodeThread : public QThread
+{
+public:
+    VideoDecodeThread(VideoThread *thread):QThread(thread),video_thread(thread){}
+protected:
+    virtual void run() { video_thread->decodeLoop(); }
+private:
+    VideoThread *video_thread;
+};
+
 class VideoThreadPrivate : public AVThreadPrivate
 {
 public:
-    VideoThreadPrivate():conv(0),capture(0){}
+    VideoThreadPrivate():conv(0),capture(0),decode_thread(0),ahead_frames(4),ahead_bytes(0)
+      ,hurry_up(true),dropped(0),skipped(0),sync_error(0){}
+    /*
+     * A buffer of the given bytes that nobody else holds. bits is the writable data.
+     * Take bits before the buffer is shared, otherwise data() detaches(copies) it
+     */
+    QByteArray frameBuffer(int bytes, quint8 **bits) {
+        for (int i = 0; i < frame_pool.size(); ++i) {
+            QByteArray &buf = frame_pool[i];
+            if (!buf.isDetached())
+                continue;
+            if (buf.size() != bytes)
+                buf.resize(bytes);
+            *bits = (quint8*)buf.data();
+            return buf;
+        }
+        QByteArray buf;
+        buf.resize(bytes);
+        *bits = (quint8*)buf.data();
+        //queued frames + the decoding one + the presenting one + the renderer's published and painted ones + the captured one
+        if (frame_pool.size() < ahead_frames + 5)
+            frame_pool.append(buf);
+        return buf;
+    }
+    /*
+     * the policy's level, at least DropLate if faster than normal speed and SkipNonRef if faster than
+     * kNonRefSpeed: there is no time to decode and display every frame
+     */
+    int hurryUpLevel() const {
+        int level = hurry_up ? policy.level : HurryUpPolicy::Normal;
+        const qreal speed = clock->speed();
+        if (speed > kNonRefSpeed)
+            level = qMax<int>(level, HurryUpPolicy::SkipNonRef);
+        else if (speed > 1.0)
+            level = qMax<int>(level, HurryUpPolicy::DropLate);
+        return level;
+    }
     ImageConverter *conv;
     double pts; //current decoded pts. for capture
     //QImage image; //use QByteArray? Then must allocate a picture in ImageConverter, see VideoDecoder
     VideoCapture *capture;
+    VideoDecodeThread *decode_thread;
+    DecodedFrameQueue frames; //decoding thread => this thread
+    int ahead_frames, ahead_bytes;
+    QVector<QByteArray> frame_pool; //reused if not referenced by the queue, the presenter or the renderer
+    volatile bool hurry_up;
+    HurryUpPolicy policy;
+    QAtomicInt dropped, skipped;
+    volatile qreal sync_error; //moving average of |pts - clock| of the displayed frames
 };
 
 VideoThread::VideoThread(QObject *parent) :
     AVThread(*new VideoThreadPrivate(), parent)
 {
+    d_func().decode_thread = new VideoDecodeThread(this);
+}
+
+void VideoThread::setDecodeAhead(int frames, int bytes)
+{
+    DPTR_D(VideoThread);
+    d.ahead_frames = qMax(frames, 1);
+    d.ahead_bytes = qMax(bytes, 0);
+}
+
+int VideoThread::decodeAheadFrames() const
+{
+    return d_func().ahead_frames;
+}
+
+void VideoThread::setHurryUpEnabled(bool enabled)
+{
+    d_func().hurry_up = enabled;
+}
+
+bool VideoThread::isHurryUpEnabled() const
+{
+    return d_func().hurry_up;
+}
+
+int VideoThread::hurryUpLevel() const
+{
+    return d_func().policy.level;
+}
+
+int VideoThread::droppedFrames() const
+{
+    return const_cast<QAtomicInt&>(d_func().dropped).fetchAndAddOrdered(0);
+}
+
+int VideoThread::skippedFrames() const
+{
+    return const_cast<QAtomicInt&>(d_func().skipped).fetchAndAddOrdered(0);
+}
+
+qreal VideoThread::syncError() const
+{
+    return d_func().sync_error;
 }
 
 ImageConverter* VideoThread::setImageConverter(ImageConverter *converter)
@@ -74,6 +275,20 @@ VideoCapture* VideoThread::setVideoCapture(VideoCapture *cap)
     return old;
 }
 
+void VideoThread::clearBuffers()
+{
+    AVThread::clearBuffers();
+    d_func().frames.clear();
+}
+
+void VideoThread::stop()
+{
+    AVThread::stop();
+    DPTR_D(VideoThread);
+    d.frames.setBlocking(false); //wake up both the decoding thread and this thread
+    d.frames.clear();
+}
+
 //TODO: if output is null or dummy, the use duration to wait
 void VideoThread::run()
 {
@@ -83,7 +298,16 @@ void VideoThread::run()
         return;
     resetState();
     Q_ASSERT(d.clock != 0);
-    VideoDecoder *dec = static_cast<VideoDecoder*>(d.dec);
+    d.frames.setBlocking(true);
+    d.frames.clear();
+    d.frames.setCapacity(d.ahead_frames);
+    d.frames.setThreshold(d.ahead_frames);
+    d.frames.setMaxBytes(d.ahead_bytes);
+    d.policy.reset();
+    d.dropped.fetchAndStoreOrdered(0);
+    d.skipped.fetchAndStoreOrdered(0);
+    d.sync_error = 0;
+    d.decode_thread->start();
     VideoRenderer* vo = static_cast<VideoRenderer*>(d.writer);
     while (!d.stop) {
         //TODO: why put it at the end of loop then playNextFrame() not work?
@@ -91,77 +315,149 @@ void VideoThread::run()
             if (d.stop)
                 break; //the queue is empty and may block. should setBlocking(false) wake up cond empty?
         }
+        DecodedFrame frame = d.frames.take(); //wait for the decoding thread
+        if (!frame.isValid()) //end of stream or stopped
+            break;
+        //decoded from a packet before seeking
+        if (frame.serial != d.serial)
+            continue;
         QMutexLocker locker(&d.mutex);
         Q_UNUSED(locker);
-        if (d.packets.isEmpty() && !d.stop) {
-            d.stop = d.demux_end;
-            if (d.stop) {
-                break;
+        //Compare to the clock. in media time, speed times longer than real time
+        const qreal speed = d.clock->speed();
+        d.delay = frame.pts  - d.clock->value();
+        //the frames before seeking are dropped by serial, so the delay is always meaningful
+        if (frame.seeked) {
+            finishSeek();
+        } else {
+            if (d.hurry_up)
+                d.policy.update(-d.delay/speed);
+            if (frame.skipped) { //too late to convert
+                d.dropped.fetchAndAddOrdered(1);
+                continue;
+            }
+            if (d.delay > kSyncThreshold) { //Slow down
+                //the clock may jump meanwhile, e.g. audio is updated after seeking
+                d.delay = waitForClock(frame.pts, frame.serial);
+                if (frame.serial != d.serial) //seeked when waiting
+                    continue;
+            } else if (d.delay < -kSyncThreshold) { //Speed up. drop frame
+                if (d.hurryUpLevel() >= HurryUpPolicy::DropLate && d.delay < -kDropThreshold) {
+                    d.dropped.fetchAndAddOrdered(1);
+                    continue;
+                }
             }
         }
+        d.clock->updateVideoPts(frame.pts); //here?
+        d.pts = frame.pts;
+        d.sync_error = d.sync_error*0.9 + qAbs(frame.pts - d.clock->value())*0.1;
+        if (d.capture) {
+            d.capture->setRawImage(frame.data, frame.width, frame.height);
+        }
+        //TODO: Add filters here. Capture is also a filter
+        if (vo && vo->isAvailable()) {
+            //the renderer may be resized after the frame is converted
+            vo->setInSize(frame.width, frame.height);
+            vo->writeData(frame.data);
+        }
+    }
+    //the decoding thread is woken up by stop() or it ends before the end marker is put
+    d.decode_thread->wait();
+    qDebug("Video thread stops running...");
+}
+
+void VideoThread::decodeLoop()
+{
+    DPTR_D(VideoThread);
+    VideoDecoder *dec = static_cast<VideoDecoder*>(d.dec);
+    VideoRenderer* vo = static_cast<VideoRenderer*>(d.writer);
+    QSize size; //the renderer's size when the last frame is decoded
+    bool seeked = false; //the next frame is the first after seeking
+    bool delaying = true; //no frame is output since the decoder is flushed. the packets may be delayed, not skipped
+    d.seek_target = -1;
+    dec->flush(); //may be used by the last playback
+    dec->setConvertEnabled(false); //converted into the pooled buffers by convertTo()
+    while (!d.stop) {
+        if (d.packets.isEmpty() && d.demux_end)
+            break;
         Packet pkt = d.packets.take(); //wait to dequeue
-        //Compare to the clock
+        if (pkt.serial != d.serial) //taken before flush() cleared the queue, or an older flush packet
+            continue;
         if (!pkt.isValid()) {
-            qDebug("Invalid packet! flush video codec context!!!!!!!!!!");
+            if (pkt.serial == d.decoder_serial) //end marker
+                continue;
+            qDebug("flush video codec context for seek serial %d", pkt.serial);
+            d.decoder_serial = pkt.serial;
             dec->flush();
+            delaying = true;
+            d.seek_target = pkt.pts; //the flush packet of an accurate seek carries the target
+            seeked = true;
             continue;
         }
-        d.delay = pkt.pts  - d.clock->value();
-        /*
-         *after seeking forward, a packet may be the old, v packet may be
-         *the new packet, then the d.delay is very large, omit it.
-         *TODO: 1. how to choose the value
-         * 2. use last delay when seeking
-        */
-        if (qAbs(d.delay) < 2.718) {
-            if (d.delay > kSyncThreshold) { //Slow down
-                //d.delay_cond.wait(&d.mutex, d.delay*1000); //replay may fail. why?
-                //qDebug("~~~~~wating for %f msecs", d.delay*1000);
-                usleep(d.delay * 1000000);
-            } else if (d.delay < -kSyncThreshold) { //Speed up. drop frame?
-                //continue;
-            }
-        } else { //when to drop off?
-            qDebug("delay %f/%f", d.delay, d.clock->value());
-            if (d.delay > 0) {
-                msleep(64);
-            } else {
-                //audio packet not cleaned up?
-                continue;
-            }
-        }
-        d.clock->updateVideoPts(pkt.pts); //here?
         //DO NOT decode and convert if vo is not available or null!
-        //if ()
         bool vo_ok = vo && vo->isAvailable();
-        if (vo_ok) {
-            //use the last size first then update the last size so that decoder(converter) can update output size
-            if (vo->lastWidth() > 0 && vo->lastHeight() > 0 && !vo->scaleInRenderer())
-                dec->resizeVideoFrame(vo->lastSize());
+        //use the last size first then update the last size so that decoder(converter) can update output size
+        if (vo_ok && !vo->scaleInRenderer() && size.width() > 0 && size.height() > 0)
+            dec->resizeVideoFrame(size);
+        const bool seeking = d.seek_target >= 0;
+        const int level = seeking ? HurryUpPolicy::Normal : d.hurryUpLevel();
+        if (seeking) {
+            //the references of the target frame must be exact. the non-reference frames long before it are not needed
+            if (pkt.pts < d.seek_target - kSeekNonRefMargin)
+                dec->setHurryUp(VideoDecoder::HurrySkipNonRef);
             else
-                vo->setInSize(dec->width(), dec->height()); //setLastSize()
-        }
+                dec->setHurryUp(VideoDecoder::HurryNone);
+        } else if (level >= HurryUpPolicy::KeyFrameOnly)
+            dec->setHurryUp(VideoDecoder::HurryKeyFrame);
+        else if (level >= HurryUpPolicy::SkipNonRef)
+            dec->setHurryUp(VideoDecoder::HurryNonRef);
+        else
+            dec->setHurryUp(VideoDecoder::HurryNone);
+        const bool late = level >= HurryUpPolicy::SkipConvert && pkt.pts - d.clock->value() < -kDropThreshold;
         //still decode, we may need capture. TODO: decode only if existing a capture request if no vo
-        if (dec->decode(pkt.data)) {
-            d.pts = pkt.pts;
-            if (d.capture) {
-                d.capture->setRawImage(dec->data(), dec->width(), dec->height());
-            }
-            //TODO: Add filters here. Capture is also a filter
-            /*if (d.image.width() != d.renderer_width || d.image.height() != d.renderer_height)
-                d.image = QImage(d.renderer_width, d.renderer_height, QImage::Format_RGB32);
-            d.conv->setInSize(d.renderer_width, d.renderer_height);
-            if (!d.conv->convert(d.decoded_data.constData(), d.image.bits())) {
-            }*/
-            if (vo_ok) {
-                vo->writeData(dec->data());
+        const bool decoded = dec->decode(pkt);
+        delaying = delaying && !decoded;
+        if (!decoded) {
+            //after the decoder delay, a packet without a frame and error is skipped by skip_frame
+            if (dec->hurryUp() != VideoDecoder::HurryNone && dec->isFrameSkipped() && !delaying)
+                d.skipped.fetchAndAddOrdered(1);
+        } else if (seeking && beforeSeekTarget(framePts(dec, pkt), pkt.duration, d.seek_target)) {
+            //decoded as a reference of the target frame. not converted
+        } else if (late) {
+            //the presenting thread counts it and updates the policy
+            DecodedFrame frame;
+            frame.skipped = true;
+            frame.pts = framePts(dec, pkt);
+            frame.serial = pkt.serial;
+            d.frames.put(frame);
+        } else {
+            //convert into a pooled buffer directly. no allocation and no copy in the steady state
+            DecodedFrame frame;
+            frame.width = dec->width();
+            frame.height = dec->height();
+            quint8 *bits = 0;
+            frame.data = d.frameBuffer(4*frame.width*frame.height, &bits);
+            quint8 *dst[] = { bits, 0, 0, 0 };
+            const int dst_stride[] = { 4*frame.width, 0, 0, 0 }; //renderers assume packed RGB32 lines
+            if (dec->convertTo(dst, dst_stride)) {
+                frame.pts = framePts(dec, pkt);
+                frame.serial = pkt.serial;
+                frame.seeked = seeked;
+                if (seeking)
+                    qDebug("accurate seek: frame %f for target %f", frame.pts, d.seek_target);
+                seeked = false;
+                d.seek_target = -1;
+                d.frames.put(frame); //block if decoded enough
             }
         }
-        //use the last size first then update the last size so that decoder(converter) can update output size
         if (vo_ok && !vo->scaleInRenderer())
-            vo->setInSize(vo->rendererSize());
+            size = vo->rendererSize();
     }
-    qDebug("Video thread stops running...");
+    dec->setHurryUp(VideoDecoder::HurryNone);
+    dec->setConvertEnabled(true);
+    d.frame_pool.clear();
+    d.frames.put(DecodedFrame()); //end marker. wake up the presenting thread
+    qDebug("Video decoding thread stops running...");
 }
 
 } //namespace QtAV
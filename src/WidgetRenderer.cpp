@@ -48,10 +48,24 @@ WidgetRenderer::~WidgetRenderer()
 
 bool WidgetRenderer::write()
 {
-    update();
+    //called in video thread. QWidget::update() is not thread safe
+    d_func().scheduleRepaint(this);
 	return true;
 }
 
+void WidgetRenderer::customEvent(QEvent *e)
+{
+    if (e->type() != ImageRendererPrivate::repaintEventType()) {
+        QWidget::customEvent(e);
+        return;
+    }
+    d_func().repaintEventReceived();
+    //no paint event if invisible. the latest frame is painted when it is shown
+    if (!isVisible())
+        return;
+    update();
+}
+
 void WidgetRenderer::resizeEvent(QResizeEvent *e)
 {
     resizeRenderer(e->size());
@@ -118,33 +132,29 @@ void WidgetRenderer::mouseDoubleClickEvent(QMouseEvent *)
 void WidgetRenderer::paintEvent(QPaintEvent *)
 {
     DPTR_D(WidgetRenderer);
-    if (!d.scale_in_renderer) {
-        d.img_mutex.lock();
-    }
+    //the latest complete frame. the video thread writes other buffers, no lock is required
+    QImage &image = d.acquireImage();
     QPainter p(this);
     //fill background color only when the displayed frame rect not equas to renderer's
     if (d.out_rect != rect()) {
         p.fillRect(rect(), QColor(0, 0, 0));
     }
-    if (d.image.isNull()) {
+    if (image.isNull()) {
         //TODO: when setInSize()?
-        d.image = QImage(rendererSize(), QImage::Format_RGB32);
-        d.image.fill(Qt::black); //maemo 4.7.0: QImage.fill(uint)
+        image = QImage(rendererSize(), QImage::Format_RGB32);
+        image.fill(Qt::black); //maemo 4.7.0: QImage.fill(uint)
     }
     //assume that the image data is already scaled to out_size(NOT renderer size!)
-    if (!d.scale_in_renderer || d.image.size() == d.out_rect.size()) {
-        //d.preview = d.image;
-        p.drawImage(d.out_rect.topLeft(), d.image);
+    if (!d.scale_in_renderer || image.size() == d.out_rect.size()) {
+        //d.preview = image;
+        p.drawImage(d.out_rect.topLeft(), image);
     } else {
         //qDebug("size not fit. may slow. %dx%d ==> %dx%d"
-        //       , d.image.size().width(), image.size().height(), d.renderer_width, d.renderer_height);
-        p.drawImage(d.out_rect, d.image);
+        //       , image.size().width(), image.size().height(), d.renderer_width, d.renderer_height);
+        p.drawImage(d.out_rect, image);
         //what's the difference?
         //p.drawImage(QPoint(), image.scaled(d.renderer_width, d.renderer_height));
     }
-    if (!d.scale_in_renderer) {
-        d.img_mutex.unlock();
-    }
 }
 
 } //namespace QtAV
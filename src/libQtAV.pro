@@ -32,7 +32,7 @@ TRANSLATIONS = $${PROJECTROOT}/i18n/QtAV_zh_CN.ts
 #UINT64_C: C99 math features, need -D__STDC_CONSTANT_MACROS in CXXFLAGS
 DEFINES += __STDC_CONSTANT_MACROS
 
-LIBS += -Lextra -lavcodec -lavformat -lavutil -lswscale
+LIBS += -Lextra -lavcodec -lavformat -lavutil -lswscale -lswresample
 
 ipp-link {
     DEFINES += IPP_LINK
@@ -78,6 +78,9 @@ SOURCES += \
     AVThread.cpp \
     AudioDecoder.cpp \
     AudioOutput.cpp \
+    AudioResampler.cpp \
+    AudioSampleConverter.cpp \
+    AudioTimeStretch.cpp \
     AVDecoder.cpp \
     AVDemuxer.cpp \
     AVDemuxThread.cpp \
@@ -86,8 +89,13 @@ SOURCES += \
     ImageConverter.cpp \
     ImageConverterFF.cpp \
     ImageConverterIPP.cpp \
+    ImageConverterSIMD.cpp \
     ImageRenderer.cpp \
+    KeyFrameIndex.cpp \
+    MappedIO.cpp \
     Packet.cpp \
+    ReadAheadIO.cpp \
+    StreamInfoCache.cpp \
     AVPlayer.cpp \
     VideoCapture.cpp \
     VideoRenderer.cpp \
@@ -106,12 +114,22 @@ HEADERS += \
     QtAV/AudioThread.h \
     QtAV/EventFilter.h \
     QtAV/private/AudioOutput_p.h \
+    QtAV/private/AudioResampler_p.h \
+    QtAV/private/AudioRing_p.h \
+    QtAV/private/AudioSampleConverter_p.h \
+    QtAV/private/AudioTimeStretch_p.h \
     QtAV/private/AVThread_p.h \
     QtAV/private/AVDecoder_p.h \
     QtAV/private/AVOutput_p.h \
     QtAV/private/GraphicsItemRenderer_p.h \
     QtAV/private/ImageConverter_p.h \
+    QtAV/private/ImageConverterSIMD_p.h \
     QtAV/private/ImageRenderer_p.h \
+    QtAV/private/KeyFrameIndex_p.h \
+    QtAV/private/MappedIO_p.h \
+    QtAV/private/ReadAheadIO_p.h \
+    QtAV/private/SIMD_p.h \
+    QtAV/private/StreamInfoCache_p.h \
     QtAV/private/VideoRenderer_p.h \
     QtAV/private/WidgetRenderer_p.h \
     QtAV/AudioDecoder.h \
@@ -120,6 +138,7 @@ HEADERS += \
     QtAV/AVDemuxer.h \
     QtAV/AVDemuxThread.h \
     QtAV/BlockingQueue.h \
+    QtAV/BlockingRing.h \
     QtAV/GraphicsItemRenderer.h \
     QtAV/ImageConverter.h \
     QtAV/ImageRenderer.h \
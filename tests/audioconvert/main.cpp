@@ -0,0 +1,223 @@
+/******************************************************************************
+    Audio convert:  sample format conversion check and benchmark
+    Copyright (C) 2012-2013 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QVector>
+#include <QtAV/QtAV_Compat.h>
+#include <QtAV/private/AudioSampleConverter_p.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace QtAV;
+
+/*
+ * Converts the same random samples of each format with each kernel set and compares the output with the C
+ * kernels bit by bit. Odd lengths cover the tails converted after the vector loops. Then converts 7.1 96kHz
+ * frames to interleaved float and prints the throughput of the previous AudioDecoder loops and of each kernel
+ * set. Returns 1 if any output differs. usage: audioconvert [seconds of audio]
+ */
+
+static const int kChannels = 8;
+static const int kSamples = 1024; //per channel per frame
+static const int kRate = 96000;
+
+//the loops used by AudioDecoder before the kernels. out must have 1 more float(the loops write out[n])
+static void legacyToFloat(int fmt, quint8 **in, int channels, int samples, float *out)
+{
+    static const float kInt8_inv = 1.0f/128.0f;
+    static const float kInt16_inv = 1.0f/32768.0f;
+    static const float kInt32_inv = 1.0f/2147483648.0f;
+    const int n = samples*channels;
+    const int half = n/2;
+    switch (fmt) {
+    case AV_SAMPLE_FMT_U8: {
+        uint8_t *data = in[0];
+        for (int i = 0; i < half; i++) {
+            out[i] = (data[i] - 0x7F) * kInt8_inv;
+            out[n - i] = (data[n - i] - 0x7F) * kInt8_inv;
+        }
+    }
+        break;
+    case AV_SAMPLE_FMT_S16: {
+        int16_t *data = (int16_t*)in[0];
+        for (int i = 0; i < half; i++) {
+            out[i] = data[i] * kInt16_inv;
+            out[n - i] = data[n - i] * kInt16_inv;
+        }
+    }
+        break;
+    case AV_SAMPLE_FMT_S32: {
+        int32_t *data = (int32_t*)in[0];
+        for (int i = 0; i < half; i++) {
+            out[i] = data[i] * kInt32_inv;
+            out[n - i] = data[n - i] * kInt32_inv;
+        }
+    }
+        break;
+    case AV_SAMPLE_FMT_FLT:
+        memcpy(out, in[0], n*sizeof(float));
+        break;
+    case AV_SAMPLE_FMT_DBL: {
+        double *data = (double*)in[0];
+        for (int i = 0; i < half; i++) {
+            out[i] = data[i];
+            out[n - i] = data[n - i];
+        }
+    }
+        break;
+#define LEGACY_PLANAR(T, expr) \
+    { \
+        T **data = (T**)in; \
+        for (int i = 0; i < samples; ++i) { \
+            for (int ch = 0; ch < channels; ++ch) { \
+                *out++ = expr; \
+            } \
+        } \
+    }
+    case AV_SAMPLE_FMT_U8P: LEGACY_PLANAR(uint8_t, (data[ch][i] - 0x7F) * kInt8_inv) break;
+    case AV_SAMPLE_FMT_S16P: LEGACY_PLANAR(uint16_t, data[ch][i] * kInt16_inv) break;
+    case AV_SAMPLE_FMT_S32P: LEGACY_PLANAR(uint32_t, data[ch][i] * kInt32_inv) break;
+    case AV_SAMPLE_FMT_FLTP: LEGACY_PLANAR(float, data[ch][i]) break;
+    case AV_SAMPLE_FMT_DBLP: LEGACY_PLANAR(double, data[ch][i]) break;
+#undef LEGACY_PLANAR
+    default:
+        break;
+    }
+}
+
+//random bytes. floats and doubles in [-1, 1]
+static void fillRandom(AVSampleFormat fmt, QByteArray *buf)
+{
+    for (int i = 0; i < buf->size(); ++i)
+        (*buf)[i] = char(rand());
+    if (fmt != AV_SAMPLE_FMT_FLT && fmt != AV_SAMPLE_FMT_FLTP && fmt != AV_SAMPLE_FMT_DBL && fmt != AV_SAMPLE_FMT_DBLP)
+        return;
+    const int bytes = av_get_bytes_per_sample(fmt);
+    for (int i = 0; i + bytes <= buf->size(); i += bytes) {
+        const double v = double(rand())/RAND_MAX*2.0 - 1.0;
+        if (bytes == 4) {
+            const float fv = v;
+            memcpy(buf->data() + i, &fv, bytes);
+        } else {
+            memcpy(buf->data() + i, &v, bytes);
+        }
+    }
+}
+
+//returns the number of outputs different from the C kernels'
+static int checkKernels(const int *formats, int nb_formats, const AudioSampleConverter *converters
+                        , const char *const *names, int nb_kernels)
+{
+    static const int kCheckChannels[] = { 1, 2, 3, 6, 8 };
+    //not multiples of the vector width. 4097*8 floats are more than 1 planar block
+    static const int kCheckSamples[] = { 1, 2, 3, 5, 7, 15, 17, 31, 33, 63, 65, 1023, 4097 };
+    static const float kGuard = 12345.0f; //detects writes after the end
+    int errors = 0;
+    for (int f = 0; f < nb_formats; ++f) {
+        const AVSampleFormat fmt = (AVSampleFormat)formats[f];
+        const bool planar = av_sample_fmt_is_planar(fmt);
+        const int bytes = av_get_bytes_per_sample(fmt);
+        for (size_t c = 0; c < sizeof(kCheckChannels)/sizeof(kCheckChannels[0]); ++c) {
+            for (size_t s = 0; s < sizeof(kCheckSamples)/sizeof(kCheckSamples[0]); ++s) {
+                const int channels = kCheckChannels[c], samples = kCheckSamples[s];
+                QVector<QByteArray> planes(planar ? channels : 1);
+                QVector<const quint8*> in(planes.size());
+                for (int p = 0; p < planes.size(); ++p) {
+                    planes[p].resize((planar ? samples : samples*channels)*bytes);
+                    fillRandom(fmt, &planes[p]);
+                    in[p] = (const quint8*)planes[p].constData();
+                }
+                QVector<float> ref(samples*channels + 1, kGuard);
+                converters[0].toFloat(fmt, in.constData(), channels, samples, ref.data());
+                for (int k = 1; k < nb_kernels; ++k) {
+                    if (converters[k].kernels() != k + 1)
+                        continue;
+                    QVector<float> out(samples*channels + 1, kGuard);
+                    if (!converters[k].toFloat(fmt, in.constData(), channels, samples, out.data())
+                            || memcmp(out.constData(), ref.constData(), out.size()*sizeof(float))) {
+                        ++errors;
+                        printf("FAIL %s %s %d channels %d samples\n", names[k], av_get_sample_fmt_name(fmt)
+                               , channels, samples);
+                    }
+                }
+            }
+        }
+    }
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    const int seconds = argc > 1 ? qMax(atoi(argv[1]), 1) : 60;
+    const int frames = seconds*kRate/kSamples;
+    static const int kFormats[] = {
+        AV_SAMPLE_FMT_U8, AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_FLT, AV_SAMPLE_FMT_DBL,
+        AV_SAMPLE_FMT_U8P, AV_SAMPLE_FMT_S16P, AV_SAMPLE_FMT_S32P, AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_DBLP
+    };
+    AudioSampleConverter converters[] = {
+        AudioSampleConverter(AudioSampleConverter::C),
+        AudioSampleConverter(AudioSampleConverter::SSE2),
+        AudioSampleConverter(AudioSampleConverter::AVX2)
+    };
+    static const char* kNames[] = { "C", "SSE2", "AVX2" };
+    const int nb_formats = sizeof(kFormats)/sizeof(kFormats[0]);
+    for (int k = 0; k < 3; ++k)
+        printf("%s: %s\n", kNames[k], converters[k].kernels() == k + 1 ? "checked" : "not supported");
+    const int errors = checkKernels(kFormats, nb_formats, converters, kNames, 3);
+    printf("%d different outputs\n", errors);
+    printf("%d channels, %d Hz, %d seconds. Msamples/s(x realtime)\n", kChannels, kRate, seconds);
+    printf("%-6s %16s", "format", "legacy");
+    for (int k = 0; k < 3; ++k)
+        printf(" %16s", converters[k].kernels() == k + 1 ? kNames[k] : "(n/a)");
+    printf("\n");
+    QVector<float> out(kChannels*kSamples + 1);
+    for (int f = 0; f < nb_formats; ++f) {
+        const AVSampleFormat fmt = (AVSampleFormat)kFormats[f];
+        const bool planar = av_sample_fmt_is_planar(fmt);
+        const int bytes = av_get_bytes_per_sample(fmt);
+        QVector<QByteArray> planes(planar ? kChannels : 1);
+        quint8* in[kChannels];
+        for (int p = 0; p < planes.size(); ++p) {
+            //1 more sample for the legacy loops
+            planes[p].resize((planar ? kSamples : kSamples*kChannels)*bytes + bytes);
+            fillRandom(fmt, &planes[p]);
+            in[p] = (quint8*)planes[p].data();
+        }
+        printf("%-6s", av_get_sample_fmt_name(fmt));
+        for (int k = -1; k < 3; ++k) {
+            QElapsedTimer timer;
+            timer.start();
+            for (int i = 0; i < frames; ++i) {
+                if (k < 0)
+                    legacyToFloat(fmt, in, kChannels, kSamples, out.data());
+                else
+                    converters[k].toFloat(fmt, in, kChannels, kSamples, out.data());
+            }
+            const qreal s = qMax<qint64>(timer.elapsed(), 1)/1000.0;
+            const qreal msamples = qreal(frames)*kSamples*kChannels/s/1e6;
+            printf(" %8.1f(%6.0fx)", msamples, seconds/s);
+        }
+        printf("\n");
+    }
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,13 @@
+QT       += core
+QT       -= gui
+
+TARGET = audioring
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+PROJECTROOT = $$PWD/../..
+include($$PROJECTROOT/src/libQtAV.pri)
+preparePaths($$OUT_PWD/../../out)
+
+SOURCES += main.cpp
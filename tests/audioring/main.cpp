@@ -0,0 +1,105 @@
+/******************************************************************************
+    Audio ring:  AOPortAudio ring check
+    Copyright (C) 2012-2013 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QVector>
+#include <QtAV/private/AudioRing_p.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace QtAV;
+
+/*
+ * Feeds the ring of AOPortAudio like the audio thread and drains it like the PortAudio callback with random
+ * sizes. The capacity is not a multiple of 3 or 6 channels. The reader often asks for more than is buffered
+ * (underrun) and the buffered floats are discarded sometimes, as after seeking. Each float is the channel of
+ * the sample, so a partial frame would swap the channels.
+ * Returns 1 if any read is not whole frames or a channel is out of order. usage: audioring [rounds]
+ */
+
+static const int kRingFloats = 1000; //capacity 1024
+
+//returns the number of errors
+static int check(int channels, int rounds)
+{
+    AudioRing ring;
+    ring.resize(kRingFloats, channels);
+    QVector<float> in(ring.capacity() + channels);
+    for (int i = 0; i < in.size(); ++i)
+        in[i] = i % channels;
+    QVector<float> out(ring.capacity() + channels);
+    int errors = 0;
+    int underruns = 0;
+    int write_ch = 0; //channel of the next float written
+    for (int r = 0; r < rounds; ++r) {
+        //not whole frames sometimes. the ring writes whole frames only
+        const int n = rand() % (ring.capacity()/2);
+        const int written = ring.write(in.constData() + write_ch, n);
+        if (written % channels) {
+            ++errors;
+            printf("FAIL %d channels: %d floats written\n", channels, written);
+        }
+        write_ch = (write_ch + written) % channels;
+        if (rand() % 64 == 0) {
+            ring.discard();
+            if (ring.available()) {
+                ++errors;
+                printf("FAIL %d channels: %d floats after discard\n", channels, ring.available());
+            }
+        }
+        //the callback reads 1 or more times, more than written sometimes
+        const int reads = 1 + rand() % 3;
+        for (int k = 0; k < reads; ++k) {
+            const int wanted = (1 + rand() % (ring.capacity()/(2*channels)))*channels;
+            const int got = ring.read(out.data(), wanted);
+            if (got < wanted)
+                ++underruns;
+            if (got % channels) {
+                ++errors;
+                printf("FAIL %d channels: %d floats read\n", channels, got);
+                continue;
+            }
+            for (int i = 0; i < got; ++i) {
+                if (out[i] != i % channels) {
+                    ++errors;
+                    printf("FAIL %d channels: channel %d is read as %d\n", channels, i % channels, int(out[i]));
+                    break;
+                }
+            }
+        }
+    }
+    printf("%d channels: %d underruns, %d errors\n", channels, underruns, errors);
+    if (!underruns) {
+        ++errors;
+        printf("FAIL %d channels: no underrun\n", channels);
+    }
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    const int rounds = argc > 1 ? qMax(atoi(argv[1]), 1) : 100000;
+    static const int kChannels[] = { 1, 2, 3, 6, 8 };
+    int errors = 0;
+    for (size_t c = 0; c < sizeof(kChannels)/sizeof(kChannels[0]); ++c)
+        errors += check(kChannels[c], rounds);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,208 @@
+/******************************************************************************
+    Image convert:  SIMD image converter check and benchmark
+    Copyright (C) 2012-2013 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QVector>
+#include <QtAV/QtAV_Compat.h>
+#include <QtAV/ImageConverterTypes.h>
+#include <QtAV/private/ImageConverterSIMD_p.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace QtAV;
+
+/*
+ * Converts random pictures with each kernel set of ImageConverterSIMD and compares the output with the C kernels
+ * pixel by pixel. Odd sizes cover the tail columns converted after the vector loops. Then converts large pictures
+ * with several threads by ImageConverterSIMD and ImageConverterFF and compares the output with 1 thread, which
+ * covers the band boundaries. Then prints the 1080p throughput. Returns 1 if any output differs.
+ * usage: imageconvert [frames]
+ */
+
+static const int kPad = 37; //bytes after each source line. the strides are not aligned
+
+struct Picture
+{
+    Picture(int fmt, int w, int h) {
+        const int cw = (w + 1) >> 1;
+        const int ch = fmt == PIX_FMT_YUV422P ? h : (h + 1) >> 1;
+        const int widths[] = { w, fmt == PIX_FMT_NV12 ? 2*cw : cw, fmt == PIX_FMT_NV12 ? 0 : cw };
+        const int heights[] = { h, ch, fmt == PIX_FMT_NV12 ? 0 : ch };
+        for (int p = 0; p < 3; ++p) {
+            stride[p] = widths[p] ? widths[p] + kPad : 0;
+            planes[p].resize(stride[p]*heights[p] + 32);
+            for (int i = 0; i < planes[p].size(); ++i)
+                planes[p][i] = char(rand());
+            data[p] = (const quint8*)planes[p].constData();
+        }
+        data[3] = 0;
+        stride[3] = 0;
+    }
+    QByteArray planes[3];
+    const quint8 *data[4];
+    int stride[4];
+};
+
+static QByteArray convert(ImageConverter *conv, int fmtOut, const Picture &pic, int w_out, int h_out)
+{
+    conv->setOutFormat(fmtOut);
+    conv->setOutSize(w_out, h_out);
+    const int stride = 4*w_out + kPad;
+    QByteArray out(stride*h_out, 0);
+    quint8 *dst[] = { (quint8*)out.data(), 0, 0, 0 };
+    const int dst_stride[] = { stride, 0, 0, 0 };
+    if (!conv->convert(pic.data, pic.stride, dst, dst_stride))
+        return QByteArray();
+    return out;
+}
+
+/*
+ * Converts with 1 thread and with more threads, the output must be the same. The heights are split into bands of
+ * 64 lines at least, odd heights have odd chroma heights. ImageConverterFF splits unscaled pictures only
+ */
+static int checkBands(ImageConverter *conv, const char *name, const int *formats, const char *const *formatNames
+                      , int nb_formats)
+{
+    static const int kSizes[][2] = { { 640, 256 }, { 641, 257 }, { 333, 301 }, { 1280, 720 } };
+    static const int kThreads[] = { 2, 3, 8 };
+    int errors = 0;
+    for (int f = 0; f < nb_formats; ++f) {
+        for (size_t s = 0; s < sizeof(kSizes)/sizeof(kSizes[0]); ++s) {
+            const int width = kSizes[s][0], height = kSizes[s][1];
+            Picture pic(formats[f], width, height);
+            conv->setInFormat(formats[f]);
+            conv->setInSize(width, height);
+            //not scaled, scaled up and scaled down
+            const int sizes[][2] = { { width, height }, { width*3/2 + 1, height*2 + 1 }, { width*2/3, height/2 + 1 } };
+            for (int o = 0; o < 3; ++o) {
+                conv->setThreads(1);
+                const QByteArray ref = convert(conv, PIX_FMT_RGB32, pic, sizes[o][0], sizes[o][1]);
+                for (size_t t = 0; t < sizeof(kThreads)/sizeof(kThreads[0]); ++t) {
+                    conv->setThreads(kThreads[t]);
+                    const QByteArray result = convert(conv, PIX_FMT_RGB32, pic, sizes[o][0], sizes[o][1]);
+                    if (ref.isEmpty() || result != ref) {
+                        ++errors;
+                        printf("FAIL %s %d threads %s %dx%d => %dx%d\n", name, kThreads[t], formatNames[f], width, height
+                               , sizes[o][0], sizes[o][1]);
+                    }
+                }
+            }
+        }
+    }
+    conv->setThreads(1);
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    const int frames = argc > 1 ? qMax(atoi(argv[1]), 1) : 200;
+    static const int kFormats[] = { PIX_FMT_YUV420P, PIX_FMT_NV12, PIX_FMT_YUV422P };
+    static const char* kFormatNames[] = { "yuv420p", "nv12", "yuv422p" };
+    static const int kWidths[] = { 1, 2, 3, 15, 16, 17, 31, 32, 33, 47, 63, 64, 65, 127, 641 };
+    static const int kHeights[] = { 1, 2, 7, 34 };
+    static const ImageConverterSIMD::Kernels kKernels[] = {
+        ImageConverterSIMD::C, ImageConverterSIMD::SSE2, ImageConverterSIMD::SSSE3, ImageConverterSIMD::AVX2
+    };
+    static const char* kNames[] = { "C", "SSE2", "SSSE3", "AVX2" };
+    const int nb_kernels = sizeof(kKernels)/sizeof(kKernels[0]);
+    ImageConverterSIMD *conv[nb_kernels];
+    for (int k = 0; k < nb_kernels; ++k) {
+        conv[k] = new ImageConverterSIMD(kKernels[k]);
+        conv[k]->setThreads(1);
+        printf("%s: %s\n", kNames[k], conv[k]->kernels() == kKernels[k] ? "checked" : "not supported");
+    }
+    int errors = 0;
+    for (size_t f = 0; f < sizeof(kFormats)/sizeof(kFormats[0]); ++f) {
+        for (size_t w = 0; w < sizeof(kWidths)/sizeof(kWidths[0]); ++w) {
+            for (size_t h = 0; h < sizeof(kHeights)/sizeof(kHeights[0]); ++h) {
+                const int width = kWidths[w], height = kHeights[h];
+                Picture pic(kFormats[f], width, height);
+                //not scaled, scaled up and scaled down
+                const int sizes[][2] = {
+                    { width, height }, { width*3/2 + 1, height*2 + 1 }, { qMax(width*2/3, 1), qMax(height/2, 1) }
+                };
+                for (int s = 0; s < 3; ++s) {
+                    for (int out = 0; out < 2; ++out) {
+                        const int fmt_out = out ? PIX_FMT_BGR32 : PIX_FMT_RGB32;
+                        QByteArray ref;
+                        for (int k = 0; k < nb_kernels; ++k) {
+                            if (conv[k]->kernels() != kKernels[k])
+                                continue;
+                            conv[k]->setInFormat(kFormats[f]);
+                            conv[k]->setInSize(width, height);
+                            const QByteArray result = convert(conv[k], fmt_out, pic, sizes[s][0], sizes[s][1]);
+                            if (k == 0) {
+                                ref = result;
+                                continue;
+                            }
+                            if (result.isEmpty() || result != ref) {
+                                ++errors;
+                                printf("FAIL %s %s %dx%d => %dx%d %s\n", kNames[k], kFormatNames[f], width, height
+                                       , sizes[s][0], sizes[s][1], out ? "bgr32" : "rgb32");
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    //the band split of every kernel set and of FFmpeg
+    for (int k = 0; k < nb_kernels; ++k) {
+        if (conv[k]->kernels() == kKernels[k])
+            errors += checkBands(conv[k], kNames[k], kFormats, kFormatNames, sizeof(kFormats)/sizeof(kFormats[0]));
+    }
+    ImageConverter *ff = ImageConverterFactory::create(ImageConverterId_FF);
+    if (ff) {
+        errors += checkBands(ff, "FFmpeg", kFormats, kFormatNames, sizeof(kFormats)/sizeof(kFormats[0]));
+        delete ff;
+    } else {
+        printf("FFmpeg: not supported\n");
+    }
+    printf("%d different outputs\n", errors);
+    //throughput of 1 thread
+    printf("1920x1080 => 1920x1080 and 1280x720, frames/s\n");
+    printf("%-8s", "format");
+    for (int k = 0; k < nb_kernels; ++k)
+        printf(" %16s", conv[k]->kernels() == kKernels[k] ? kNames[k] : "(n/a)");
+    printf("\n");
+    for (size_t f = 0; f < sizeof(kFormats)/sizeof(kFormats[0]); ++f) {
+        Picture pic(kFormats[f], 1920, 1080);
+        printf("%-8s", kFormatNames[f]);
+        for (int k = 0; k < nb_kernels; ++k) {
+            conv[k]->setInFormat(kFormats[f]);
+            conv[k]->setInSize(1920, 1080);
+            qreal fps[2];
+            for (int s = 0; s < 2; ++s) {
+                QElapsedTimer timer;
+                timer.start();
+                for (int i = 0; i < frames; ++i)
+                    convert(conv[k], PIX_FMT_RGB32, pic, s ? 1280 : 1920, s ? 720 : 1080);
+                fps[s] = frames*1000.0/qMax<qint64>(timer.elapsed(), 1);
+            }
+            printf(" %7.0f/%-8.0f", fps[0], fps[1]);
+        }
+        printf("\n");
+    }
+    for (int k = 0; k < nb_kernels; ++k)
+        delete conv[k];
+    return errors ? 1 : 0;
+}
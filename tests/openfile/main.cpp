@@ -0,0 +1,89 @@
+/******************************************************************************
+    Open file:  file opening benchmark
+    Copyright (C) 2012-2013 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QStringList>
+#include <QtAV/AVClock.h>
+#include <QtAV/AVDemuxer.h>
+#include <stdio.h>
+
+using namespace QtAV;
+
+/*
+ * Loads each file several times with the default probing, the fast open profile and the fast open profile
+ * with the stream info cache, and prints the average time of opening, finding the stream info and the whole
+ * loading. The first load of each mode is not counted, so the files are in the OS cache.
+ * usage: openfile [-n times] file1 [file2 ...]
+ */
+struct Mode {
+    const char *name;
+    bool fast, cache;
+};
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+    args.removeFirst();
+    int times = 5;
+    if (args.size() > 1 && args.first() == "-n") {
+        times = qMax(1, args.at(1).toInt());
+        args = args.mid(2);
+    }
+    if (args.isEmpty()) {
+        printf("usage: openfile [-n times] file1 [file2 ...]\n");
+        return 1;
+    }
+    static const Mode modes[] = {
+        { "default", false, false },
+        { "fast", true, false },
+        { "fast+cache", true, true }
+    };
+    AVClock clock;
+    AVDemuxer demuxer;
+    demuxer.setClock(&clock);
+    printf("%-12s %10s %10s %10s  (ms per file)\n", "mode", "open", "info", "load");
+    for (unsigned int m = 0; m < sizeof(modes)/sizeof(modes[0]); ++m) {
+        demuxer.setFastOpen(modes[m].fast);
+        demuxer.setStreamInfoCacheEnabled(modes[m].cache);
+        qint64 open = 0, info = 0, load = 0;
+        int loaded = 0;
+        for (int i = 0; i <= times; ++i) {
+            foreach (const QString& file, args) {
+                if (!demuxer.loadFile(file)) {
+                    printf("can not load %s\n", qPrintable(file));
+                    continue;
+                }
+                if (i == 0) //warm up. the cache is filled
+                    continue;
+                open += demuxer.openInputTime();
+                info += demuxer.streamInfoTime();
+                load += demuxer.loadTime();
+                ++loaded;
+            }
+        }
+        demuxer.close();
+        if (!loaded)
+            continue;
+        printf("%-12s %10.2f %10.2f %10.2f\n", modes[m].name
+               , (double)open/loaded, (double)info/loaded, (double)load/loaded);
+    }
+    return 0;
+}
@@ -2,4 +2,9 @@ TEMPLATE = subdirs
 
 SUBDIRS += \
     clockcontrol \
-    sharedoutput
+    sharedoutput \
+    audioconvert \
+    timestretch \
+    openfile \
+    imageconvert \
+    audioring
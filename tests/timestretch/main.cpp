@@ -0,0 +1,153 @@
+/******************************************************************************
+    Time stretch:  audio time-stretching benchmark
+    Copyright (C) 2012-2013 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QVector>
+#include <QtAV/QtAV_Compat.h>
+#include <QtAV/private/AudioTimeStretch_p.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+using namespace QtAV;
+
+/*
+ * Time-stretches 7.1 48kHz audio at several speeds. Checks that the output duration is the input duration / speed
+ * and that the SSE2/AVX2 kernels output the same samples as C, up to the float rounding of the correlation sums.
+ * Then prints the output duration and how many times faster than real time each kernel set is.
+ * Returns 1 if a check fails. usage: timestretch [seconds of audio]
+ */
+
+static const int kChannels = 8;
+static const int kSamples = 1024; //per channel per frame
+static const int kRate = 48000;
+static const qreal kSpeeds[] = { 0.25, 0.5, 0.8, 1.0, 1.25, 1.5, 2.0, 4.0 };
+static const char* kNames[] = { "C", "SSE2", "AVX2" };
+static const double kMaxDiff = 1e-4; //different sum order of the correlation
+static const qreal kMaxDurationError = 0.02; //seconds. about 1 hop
+
+/*
+ * Stretches 10s of input in frames of random sizes with each kernel set. Returns the number of errors: the output
+ * duration + the buffered duration / speed is not input / speed, or the output differs from the C kernels
+ */
+static int check(const QVector<float> &in)
+{
+    const int nb_frames = in.size()/kChannels;
+    const int input_frames = 10*kRate;
+    int errors = 0;
+    for (size_t i = 0; i < sizeof(kSpeeds)/sizeof(kSpeeds[0]); ++i) {
+        AudioTimeStretch stretch[3] = {
+            AudioTimeStretch(AudioTimeStretch::C), AudioTimeStretch(AudioTimeStretch::SSE2), AudioTimeStretch(AudioTimeStretch::AVX2)
+        };
+        for (int k = 0; k < 3; ++k) {
+            stretch[k].setFormat(kRate, kChannels);
+            stretch[k].setSpeed(kSpeeds[i]);
+        }
+        qint64 out_frames = 0;
+        double max_diff = 0;
+        int pos = 0;
+        for (int done = 0; done < input_frames; ) {
+            const int n = qMin(1 + rand() % (2*kSamples), input_frames - done);
+            if (pos + n > nb_frames)
+                pos = 0;
+            QByteArray out[3];
+            for (int k = 0; k < 3; ++k)
+                stretch[k].process(in.constData() + pos*kChannels, n, &out[k]);
+            pos += n;
+            done += n;
+            out_frames += out[0].size()/(kChannels*sizeof(float));
+            for (int k = 1; k < 3; ++k) {
+                if (stretch[k].kernels() != AudioTimeStretch::C + k)
+                    continue;
+                if (out[k].size() != out[0].size()) {
+                    max_diff = 1e300;
+                    continue;
+                }
+                const float *a = (const float*)out[0].constData();
+                const float *b = (const float*)out[k].constData();
+                for (int j = 0; j < out[k].size()/int(sizeof(float)); ++j)
+                    max_diff = qMax(max_diff, (double)qAbs(a[j] - b[j]));
+            }
+        }
+        const qreal expected = (qreal(input_frames)/kRate - stretch[0].buffered())/kSpeeds[i];
+        const qreal duration = qreal(out_frames)/kRate;
+        if (qAbs(duration - expected) > kMaxDurationError) {
+            ++errors;
+            printf("FAIL speed %.2f: %.3fs output, %.3fs expected\n", kSpeeds[i], duration, expected);
+        }
+        if (max_diff > kMaxDiff) {
+            ++errors;
+            printf("FAIL speed %.2f: the kernels differ from C by %g\n", kSpeeds[i], max_diff);
+        }
+    }
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    const int seconds = argc > 1 ? qMax(atoi(argv[1]), 1) : 60;
+    const int frames = seconds*kRate/kSamples;
+    //a chord. different in each channel
+    QVector<float> in(kSamples*kChannels*16);
+    for (int i = 0; i < in.size()/kChannels; ++i) {
+        for (int c = 0; c < kChannels; ++c)
+            in[i*kChannels + c] = 0.3*sin(2.0*M_PI*(220.0 + 55.0*c)*i/kRate) + 0.2*sin(2.0*M_PI*330.0*i/kRate);
+    }
+    for (int k = 0; k < 3; ++k) {
+        AudioTimeStretch s((AudioTimeStretch::Kernels)(AudioTimeStretch::C + k));
+        printf("%s: %s\n", kNames[k], s.kernels() == AudioTimeStretch::C + k ? "checked" : "not supported");
+    }
+    const int errors = check(in);
+    printf("%d failed checks\n", errors);
+    printf("%d channels, %d Hz, %d seconds. output seconds(x realtime)\n", kChannels, kRate, seconds);
+    printf("%-6s", "speed");
+    for (int k = 0; k < 3; ++k) {
+        AudioTimeStretch s((AudioTimeStretch::Kernels)(AudioTimeStretch::C + k));
+        printf(" %16s", s.kernels() == AudioTimeStretch::C + k ? kNames[k] : "(n/a)");
+    }
+    printf("\n");
+    QByteArray out;
+    for (size_t i = 0; i < sizeof(kSpeeds)/sizeof(kSpeeds[0]); ++i) {
+        printf("%-6.2f", kSpeeds[i]);
+        for (int k = 0; k < 3; ++k) {
+            AudioTimeStretch stretch((AudioTimeStretch::Kernels)(AudioTimeStretch::C + k));
+            stretch.setFormat(kRate, kChannels);
+            stretch.setSpeed(kSpeeds[i]);
+            qint64 samples = 0;
+            QElapsedTimer timer;
+            timer.start();
+            for (int f = 0; f < frames; ++f) {
+                stretch.process(in.constData() + (f%16)*kSamples*kChannels, kSamples, &out);
+                samples += out.size()/(kChannels*sizeof(float));
+            }
+            const qreal s = qMax<qint64>(timer.elapsed(), 1)/1000.0;
+            const qreal out_seconds = qreal(samples)/kRate;
+            printf(" %7.1f(%6.0fx)", out_seconds, out_seconds/s);
+        }
+        printf("\n");
+    }
+    return errors ? 1 : 0;
+}